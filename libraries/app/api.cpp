@@ -106,6 +106,10 @@ namespace graphene { namespace app {
        {
           _orders_api = std::make_shared< orders_api >( std::ref( _app ) );
        }
+       else if( api_name == "metrics_api" )
+       {
+          _metrics_api = std::make_shared< metrics_api >( std::ref( *_app.chain_database() ) );
+       }
        else if( api_name == "debug_api" )
        {
           // can only enable this API if the plugin was loaded
@@ -160,8 +164,7 @@ namespace graphene { namespace app {
 
     void network_broadcast_api::broadcast_transaction(const precomputable_transaction& trx)
     {
-       _app.chain_database()->precompute_parallel( trx ).wait();
-       _app.chain_database()->push_transaction(trx);
+       _app.admit_transaction( trx );
        if( _app.p2p_node() != nullptr )
           _app.p2p_node()->broadcast_transaction(trx);
     }
@@ -186,9 +189,8 @@ namespace graphene { namespace app {
 
     void network_broadcast_api::broadcast_transaction_with_callback(confirmation_callback cb, const precomputable_transaction& trx)
     {
-       _app.chain_database()->precompute_parallel( trx ).wait();
        _callbacks[trx.id()] = cb;
-       _app.chain_database()->push_transaction(trx);
+       _app.admit_transaction( trx );
        if( _app.p2p_node() != nullptr )
           _app.p2p_node()->broadcast_transaction(trx);
     }
@@ -277,6 +279,12 @@ namespace graphene { namespace app {
        return *_orders_api;
     }
 
+    fc::api<metrics_api> login_api::metrics() const
+    {
+       FC_ASSERT(_metrics_api);
+       return *_metrics_api;
+    }
+
     fc::api<graphene::debug_witness::debug_api> login_api::debug() const
     {
        FC_ASSERT(_debug_api);
@@ -319,29 +327,30 @@ namespace graphene { namespace app {
        const auto& db = *_app.chain_database();
        FC_ASSERT( limit <= 100 );
        vector<operation_history_object> result;
-       account_id_type account;
-       try {
-          account = database_api.get_account_id_from_string(account_id_or_name);
-          const account_transaction_history_object& node = account(db).statistics(db).most_recent_op(db);
-          if(start == operation_history_id_type() || start.instance.value > node.operation_id.instance.value)
-             start = node.operation_id;
-       } catch(...) { return result; }
-
-       const auto& hist_idx = db.get_index_type<account_transaction_history_index>();
-       const auto& by_op_idx = hist_idx.indices().get<by_op>();
-       auto index_start = by_op_idx.begin();
-       auto itr = by_op_idx.lower_bound(boost::make_tuple(account, start));
-
-       while(itr != index_start && itr->account == account && itr->operation_id.instance.value > stop.instance.value && result.size() < limit)
-       {
-          if(itr->operation_id.instance.value <= start.instance.value)
-             result.push_back(itr->operation_id(db));
-          --itr;
-       }
-       if(stop.instance.value == 0 && result.size() < limit && itr->account == account) {
-         result.push_back(itr->operation_id(db));
-       }
+       db.read_state( [&]() {
+          account_id_type account;
+          try {
+             account = database_api.get_account_id_from_string(account_id_or_name);
+             const account_transaction_history_object& node = account(db).statistics(db).most_recent_op(db);
+             if(start == operation_history_id_type() || start.instance.value > node.operation_id.instance.value)
+                start = node.operation_id;
+          } catch(...) { return; }
+
+          const auto& hist_idx = db.get_index_type<account_transaction_history_index>();
+          const auto& by_op_idx = hist_idx.indices().get<by_op>();
+          auto index_start = by_op_idx.begin();
+          auto itr = by_op_idx.lower_bound(boost::make_tuple(account, start));
 
+          while(itr != index_start && itr->account == account && itr->operation_id.instance.value > stop.instance.value && result.size() < limit)
+          {
+             if(itr->operation_id.instance.value <= start.instance.value)
+                result.push_back(itr->operation_id(db));
+             --itr;
+          }
+          if(stop.instance.value == 0 && result.size() < limit && itr->account == account) {
+            result.push_back(itr->operation_id(db));
+          }
+       });
        return result;
     }
 
@@ -355,32 +364,34 @@ namespace graphene { namespace app {
        const auto& db = *_app.chain_database();
        FC_ASSERT( limit <= 100 );
        vector<operation_history_object> result;
-       account_id_type account;
-       try {
-          account = database_api.get_account_id_from_string(account_id_or_name);
-       } catch(...) { return result; }
-       const auto& stats = account(db).statistics(db);
-       if( stats.most_recent_op == account_transaction_history_id_type() ) return result;
-       const account_transaction_history_object* node = &stats.most_recent_op(db);
-       if( start == operation_history_id_type() )
-          start = node->operation_id;
-
-       while(node && node->operation_id.instance.value > stop.instance.value && result.size() < limit)
-       {
-          if( node->operation_id.instance.value <= start.instance.value ) {
+       db.read_state( [&]() {
+          account_id_type account;
+          try {
+             account = database_api.get_account_id_from_string(account_id_or_name);
+          } catch(...) { return; }
+          const auto& stats = account(db).statistics(db);
+          if( stats.most_recent_op == account_transaction_history_id_type() ) return;
+          const account_transaction_history_object* node = &stats.most_recent_op(db);
+          if( start == operation_history_id_type() )
+             start = node->operation_id;
+
+          while(node && node->operation_id.instance.value > stop.instance.value && result.size() < limit)
+          {
+             if( node->operation_id.instance.value <= start.instance.value ) {
 
-             if(node->operation_id(db).op.which() == operation_type)
-               result.push_back( node->operation_id(db) );
+                if(node->operation_id(db).op.which() == operation_type)
+                  result.push_back( node->operation_id(db) );
+             }
+             if( node->next == account_transaction_history_id_type() )
+                node = nullptr;
+             else node = &node->next(db);
           }
-          if( node->next == account_transaction_history_id_type() )
-             node = nullptr;
-          else node = &node->next(db);
-       }
-       if( stop.instance.value == 0 && result.size() < limit ) {
-          auto head = db.find(account_transaction_history_id_type());
-          if (head != nullptr && head->account == account && head->operation_id(db).op.which() == operation_type)
-            result.push_back(head->operation_id(db));
-       }
+          if( stop.instance.value == 0 && result.size() < limit ) {
+             auto head = db.find(account_transaction_history_id_type());
+             if (head != nullptr && head->account == account && head->operation_id(db).op.which() == operation_type)
+               result.push_back(head->operation_id(db));
+          }
+       });
        return result;
     }
 
@@ -394,31 +405,33 @@ namespace graphene { namespace app {
        const auto& db = *_app.chain_database();
        FC_ASSERT(limit <= 100);
        vector<operation_history_object> result;
-       account_id_type account;
-       try {
-          account = database_api.get_account_id_from_string(account_id_or_name);
-       } catch(...) { return result; }
-       const auto& stats = account(db).statistics(db);
-       if( start == 0 )
-          start = stats.total_ops;
-       else
-          start = min( stats.total_ops, start );
-
-       if( start >= stop && start > stats.removed_ops && limit > 0 )
-       {
-          const auto& hist_idx = db.get_index_type<account_transaction_history_index>();
-          const auto& by_seq_idx = hist_idx.indices().get<by_seq>();
+       db.read_state( [&]() {
+          account_id_type account;
+          try {
+             account = database_api.get_account_id_from_string(account_id_or_name);
+          } catch(...) { return; }
+          const auto& stats = account(db).statistics(db);
+          if( start == 0 )
+             start = stats.total_ops;
+          else
+             start = min( stats.total_ops, start );
+
+          if( start >= stop && start > stats.removed_ops && limit > 0 )
+          {
+             const auto& hist_idx = db.get_index_type<account_transaction_history_index>();
+             const auto& by_seq_idx = hist_idx.indices().get<by_seq>();
 
-          auto itr = by_seq_idx.upper_bound( boost::make_tuple( account, start ) );
-          auto itr_stop = by_seq_idx.lower_bound( boost::make_tuple( account, stop ) );
+             auto itr = by_seq_idx.upper_bound( boost::make_tuple( account, start ) );
+             auto itr_stop = by_seq_idx.lower_bound( boost::make_tuple( account, stop ) );
 
-          do
-          {
-             --itr;
-             result.push_back( itr->operation_id(db) );
+             do
+             {
+                --itr;
+                result.push_back( itr->operation_id(db) );
+             }
+             while ( itr != itr_stop && result.size() < limit );
           }
-          while ( itr != itr_stop && result.size() < limit );
-       }
+       });
        return result;
     }
 
@@ -453,22 +466,23 @@ namespace graphene { namespace app {
        asset_id_type b = database_api.get_asset_id_from_string( asset_b );
        vector<bucket_object> result;
        result.reserve(200);
+       db.read_state( [&]() {
+          if( a > b ) std::swap(a,b);
 
-       if( a > b ) std::swap(a,b);
-
-       const auto& bidx = db.get_index_type<bucket_index>();
-       const auto& by_key_idx = bidx.indices().get<by_key>();
+          const auto& bidx = db.get_index_type<bucket_index>();
+          const auto& by_key_idx = bidx.indices().get<by_key>();
 
-       auto itr = by_key_idx.lower_bound( bucket_key( a, b, bucket_seconds, start ) );
-       while( itr != by_key_idx.end() && itr->key.open <= end && result.size() < 200 )
-       {
-          if( !(itr->key.base == a && itr->key.quote == b && itr->key.seconds == bucket_seconds) )
+          auto itr = by_key_idx.lower_bound( bucket_key( a, b, bucket_seconds, start ) );
+          while( itr != by_key_idx.end() && itr->key.open <= end && result.size() < 200 )
           {
-            return result;
+             if( !(itr->key.base == a && itr->key.quote == b && itr->key.seconds == bucket_seconds) )
+             {
+               return;
+             }
+             result.push_back(*itr);
+             ++itr;
           }
-          result.push_back(*itr);
-          ++itr;
-       }
+       });
        return result;
     } FC_CAPTURE_AND_RETHROW( (asset_a)(asset_b)(bucket_seconds)(start)(end) ) }
 
@@ -572,11 +586,10 @@ namespace graphene { namespace app {
     // get number of asset holders.
     int asset_api::get_asset_holders_count( std::string asset ) const {
 
-      const auto& bal_idx = _db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
+      const auto& holders = _db.get_index_type< primary_index< account_balance_index > >().get_secondary_index< holders_by_asset_index >();
       asset_id_type asset_id = database_api.get_asset_id_from_string( asset );      
-      auto range = bal_idx.equal_range( boost::make_tuple( asset_id ) );
 
-      int count = boost::distance(range) - 1;
+      int count = int( holders.get_balance_count( asset_id ) ) - 1;
 
       return count;
     }
@@ -584,6 +597,7 @@ namespace graphene { namespace app {
     vector<asset_holders> asset_api::get_all_asset_holders() const {
 
       vector<asset_holders> result;
+      const auto& holders = _db.get_index_type< primary_index< account_balance_index > >().get_secondary_index< holders_by_asset_index >();
 
       vector<asset_id_type> total_assets;
       for( const asset_object& asset_obj : _db.get_index_type<asset_index>().indices() )
@@ -593,10 +607,7 @@ namespace graphene { namespace app {
         asset_id_type asset_id;
         asset_id = dasset_obj.id;
 
-        const auto& bal_idx = _db.get_index_type< account_balance_index >().indices().get< by_asset_balance >();
-        auto range = bal_idx.equal_range( boost::make_tuple( asset_id ) );
-
-        int count = boost::distance(range) - 1;
+        int count = int( holders.get_balance_count( asset_id ) ) - 1;
 
         asset_holders ah;
         ah.asset_id       = asset_id;
@@ -647,4 +658,20 @@ namespace graphene { namespace app {
       return result;
    }
 
+   // metrics_api
+   vector<profile_summary> metrics_api::get_block_stage_profile()const
+   {
+      return _db.get_profiler().get_stage_profile();
+   }
+
+   vector<profile_summary> metrics_api::get_operation_profile()const
+   {
+      return _db.get_profiler().get_operation_profile();
+   }
+
+   void metrics_api::reset_profile()
+   {
+      _db.get_profiler().reset();
+   }
+
 } } // graphene::app
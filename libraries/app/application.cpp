@@ -375,6 +375,45 @@ void application_impl::startup()
       _chain_db->enable_standby_votes_tracking( _options->at("enable-standby-votes-tracking").as<bool>() );
    }
 
+   if( _options->count("enable-parallel-vote-tally") )
+   {
+      _chain_db->enable_parallel_vote_tally( _options->at("enable-parallel-vote-tally").as<bool>() );
+   }
+
+   if( _options->count("enable-profiling") )
+   {
+      _chain_db->enable_profiling( _options->at("enable-profiling").as<bool>(),
+                                   _options->at("profiling-log-interval").as<uint32_t>() );
+   }
+
+   if( _options->count("enable-mapped-block-reads") )
+   {
+      _chain_db->enable_mapped_block_reads( _options->at("enable-mapped-block-reads").as<bool>() );
+   }
+
+   if( _options->count("api-reader-threads") )
+   {
+      _chain_db->set_api_reader_threads( _options->at("api-reader-threads").as<uint16_t>() );
+   }
+
+   if( _options->count("transaction-batch-size") && _options->at("transaction-batch-size").as<uint32_t>() > 0 )
+   {
+      _trx_admission.reset( new transaction_admission( *_chain_db,
+                                                       _options->at("transaction-batch-size").as<uint32_t>() ) );
+   }
+
+   if( _options->count("replay-checkpoint-interval") )
+   {
+      _chain_db->set_replay_checkpoint_interval( _options->at("replay-checkpoint-interval").as<uint32_t>() );
+   }
+
+   if( _options->count("enable-block-log-compression") )
+   {
+      _chain_db->enable_block_log_compression( _options->at("enable-block-log-compression").as<bool>(),
+                                               _options->at("block-log-frame-size").as<uint32_t>(),
+                                               _options->at("block-log-cached-frames").as<uint32_t>() );
+   }
+
    if( _options->count("replay-blockchain") || _options->count("revalidate-blockchain") )
       _chain_db->wipe( _data_dir / "blockchain", false );
 
@@ -576,8 +615,7 @@ void application_impl::handle_transaction(const graphene::net::trx_message& tran
       trx_count = 0;
    }
 
-   _chain_db->precompute_parallel( transaction_message.trx ).wait();
-   _chain_db->push_transaction( transaction_message.trx );
+   _self->admit_transaction( transaction_message.trx );
 } FC_CAPTURE_AND_RETHROW( (transaction_message) ) }
 
 void application_impl::handle_message(const message& message_to_process)
@@ -638,6 +676,18 @@ std::vector<item_hash_t> application_impl::get_block_ids(const std::vector<item_
        FC_THROW_EXCEPTION( graphene::net::peer_is_on_an_unreachable_fork,
                            "Unable to provide a list of blocks starting at any of the blocks in peer's synopsis" );
    }
+   // a node started from a snapshot only has the blocks from the last irreversible block of the snapshot on
+   const uint32_t first_num = std::max<uint32_t>( 1, block_header::num_from_id(last_known_block_id) );
+   try
+   {
+      _chain_db->get_block_id_for_num( first_num );
+   }
+   catch( const fc::exception& )
+   {
+      FC_THROW_EXCEPTION( graphene::net::peer_is_on_an_unreachable_fork,
+                          "Unable to provide a list of blocks starting at block ${n}, they are not in our block log",
+                          ("n", first_num) );
+   }
    for( uint32_t num = block_header::num_from_id(last_known_block_id);
         num <= _chain_db->head_block_num() && result.size() < limit;
         ++num )
@@ -957,6 +1007,33 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("enable-standby-votes-tracking", bpo::value<bool>()->implicit_value(true),
           "Whether to enable tracking of votes of standby witnesses and committee members. "
           "Set it to true to provide accurate data to API clients, set to false for slightly better performance.")
+         ("enable-parallel-vote-tally", bpo::value<bool>()->implicit_value(true),
+          "Whether to sum up votes on the worker thread pool during maintenance intervals. "
+          "Results are identical, set it to true for shorter maintenance blocks on multi-core machines.")
+         ("enable-profiling", bpo::value<bool>()->implicit_value(true),
+          "Whether to time every stage of block application and every operation type. "
+          "Statistics are served by the metrics_api and summarized in the log.")
+         ("profiling-log-interval", bpo::value<uint32_t>()->default_value(1200),
+          "Number of blocks between two profiling summaries in the log, 0 to disable them")
+         ("enable-mapped-block-reads", bpo::value<bool>()->implicit_value(true),
+          "Whether to serve block reads from memory mappings of the block log instead of file streams. "
+          "Set it to true on API nodes that serve many get_block calls.")
+         ("api-reader-threads", bpo::value<uint16_t>()->default_value(0),
+          "Number of threads serving heavy API calls (full accounts, order books, trade and account history) "
+          "off the chain thread, 0 to serve them on the chain thread. A block that arrives waits for the reads in flight")
+         ("transaction-batch-size", bpo::value<uint32_t>()->default_value(0),
+          "Maximum number of incoming transactions precomputed together on the worker thread pool before they are "
+          "pushed, 0 to precompute and push every transaction on its own")
+         ("replay-checkpoint-interval", bpo::value<uint32_t>()->default_value(100000),
+          "Write the object database to disk every this many blocks while replaying, 0 to disable. "
+          "An interrupted replay continues from the last checkpoint when the node is restarted without --replay-blockchain.")
+         ("enable-block-log-compression", bpo::value<bool>()->implicit_value(true),
+          "Whether to store the blocks of a new block log as independently compressed frames. "
+          "An existing block log keeps its format, resync to convert it.")
+         ("block-log-frame-size", bpo::value<uint32_t>()->default_value(1024*1024),
+          "Uncompressed size in bytes after which blocks are sealed into a compressed frame")
+         ("block-log-cached-frames", bpo::value<uint32_t>()->default_value(16),
+          "Number of decompressed block log frames to keep in memory")
          ;
    command_line_options.add(configuration_file_options);
    command_line_options.add_options()
@@ -1011,6 +1088,22 @@ std::shared_ptr<chain::database> application::chain_database() const
    return my->_chain_db;
 }
 
+fc::path application::data_dir() const
+{
+   return my->_data_dir;
+}
+
+void application::admit_transaction( const chain::precomputable_transaction& trx )
+{
+   if( my->_trx_admission )
+      my->_trx_admission->push( trx );
+   else
+   {
+      my->_chain_db->precompute_parallel( trx ).wait();
+      my->_chain_db->push_transaction( trx );
+   }
+}
+
 void application::set_block_production(bool producing_blocks)
 {
    my->_is_block_producer = producing_blocks;
@@ -1053,6 +1146,7 @@ void application::shutdown()
 {
    if( my->_p2p_network )
       my->_p2p_network->close();
+   my->_trx_admission.reset();
    if( my->_chain_db )
    {
       my->_chain_db->close();
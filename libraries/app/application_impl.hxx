@@ -5,6 +5,7 @@
 
 #include <graphene/app/application.hpp>
 #include <graphene/app/api_access.hpp>
+#include <graphene/app/transaction_admission.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/chain/protocol/types.hpp>
 #include <graphene/net/message.hpp>
@@ -188,6 +189,8 @@ class application_impl : public net::node_delegate
       api_access _apiaccess;
 
       std::shared_ptr<graphene::chain::database>            _chain_db;
+      /// Only set when incoming transactions are admitted in batches
+      std::unique_ptr<transaction_admission>                _trx_admission;
       std::shared_ptr<graphene::net::node>                  _p2p_network;
       std::shared_ptr<fc::http::websocket_server>      _websocket_server;
       std::shared_ptr<fc::http::websocket_tls_server>  _websocket_tls_server;
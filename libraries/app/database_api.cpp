@@ -39,6 +39,7 @@
 
 #include <cfenv>
 #include <iostream>
+#include <mutex>
 
 #define GET_REQUIRED_FEES_MAX_RECURSION 4
 
@@ -46,6 +47,148 @@ typedef std::map< std::pair<graphene::chain::asset_id_type, graphene::chain::ass
 
 namespace graphene { namespace app {
 
+/// The team volume a Great Race rating is sorted by
+enum class gr_rating_volume
+{
+   none,
+   total,
+   first_half,
+   second_half,
+   interval_2,
+   interval_4,
+   interval_6,
+   interval_9,
+   interval_11,
+   interval_13
+};
+
+namespace {
+
+   /// All subscription filters are built from these parameters, so that they set the same bits for the same key
+   const fc::bloom_parameters& subscription_filter_parameters()
+   {
+      static fc::bloom_parameters param(10000, 1.0/100, 1024*8*8*2);
+      return param;
+   }
+
+   /**
+    *  Counts how many sessions set each bit of their subscription filter. A key that has one of its bits not
+    *  counted here is not in the filter of any session, which lets a change set be filtered once for all of them.
+    */
+   class subscription_filter_union
+   {
+      public:
+         static subscription_filter_union& instance()
+         {
+            static subscription_filter_union u;
+            return u;
+         }
+
+         void add( const vector<size_t>& bits )
+         {
+            std::lock_guard<std::mutex> guard( _mutex );
+            for( size_t bit : bits )
+            {
+               if( bit >= _counts.size() )
+                  _counts.resize( bit + 1 );
+               ++_counts[bit];
+            }
+         }
+
+         void remove( const vector<size_t>& bits )
+         {
+            std::lock_guard<std::mutex> guard( _mutex );
+            for( size_t bit : bits )
+               --_counts[bit];
+         }
+
+         bool contains( const vector<size_t>& bits )
+         {
+            std::lock_guard<std::mutex> guard( _mutex );
+            return std::all_of( bits.begin(), bits.end(), [this]( size_t bit ) {
+               return bit < _counts.size() && _counts[bit] > 0;
+            });
+         }
+
+      private:
+         std::mutex       _mutex;
+         vector<uint32_t> _counts;
+   };
+
+   /**
+    *  What the sessions compute from one object_change_set: the variants of the objects, and the ids that may be
+    *  subscribed by a session together with their bits in the subscription filters. Each entry is computed by the
+    *  first session that needs it and reused by all the others, which are notified one after another by the thread
+    *  that applies the block.
+    */
+   class change_set_cache
+   {
+      public:
+         enum group { new_objects, changed_objects, removed_objects, group_count };
+
+         struct candidate
+         {
+            size_t         index;
+            vector<size_t> bits;
+         };
+
+         /// @return the cache of changes, which replaces the cache of the previous change set
+         static change_set_cache& get( const std::shared_ptr<const object_change_set>& changes )
+         {
+            static change_set_cache cache;
+            if( cache._changes.lock() != changes )
+            {
+               cache = change_set_cache();
+               cache._changes = changes;
+               cache._set = changes.get();
+            }
+            return cache;
+         }
+
+         const fc::variant& object_variant( group g, size_t i, const object& obj )
+         {
+            auto& variants = _variants[g];
+            if( variants.empty() )
+               variants.resize( ids( g ).size() );
+            if( variants[i].is_null() )
+               variants[i] = obj.to_variant();
+            return variants[i];
+         }
+
+         /// @return the ids of group g that pass the union of all subscription filters, in their order in the group
+         const vector<candidate>& candidates( group g, const fc::bloom_filter& filter )
+         {
+            if( !_candidates_done[g] )
+            {
+               subscription_filter_union& filters = subscription_filter_union::instance();
+               vector<size_t> bits;
+               const auto& group_ids = ids( g );
+               for( size_t i = 0; i < group_ids.size(); ++i )
+               {
+                  filter.compute_bits( group_ids[i], bits );
+                  if( filters.contains( bits ) )
+                     _candidates[g].push_back( { i, bits } );
+               }
+               _candidates_done[g] = true;
+            }
+            return _candidates[g];
+         }
+
+      private:
+         const vector<object_id_type>& ids( group g )const
+         {
+            return g == new_objects ? _set->new_ids : g == changed_objects ? _set->changed_ids : _set->removed_ids;
+         }
+
+         std::weak_ptr<const object_change_set> _changes;
+         const object_change_set*               _set = nullptr;
+         vector<fc::variant>                    _variants[group_count];
+         vector<candidate>                      _candidates[group_count];
+         bool                                   _candidates_done[group_count] = {};
+   };
+
+} // anonymous namespace
+
 class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 {
    public:
@@ -85,6 +228,7 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       std::map<string,full_account> get_full_accounts( const vector<string>& names_or_ids, bool subscribe );
       optional<account_object> get_account_by_name( string name )const;
       vector<account_id_type> get_account_references( const std::string account_id_or_name )const;
+      optional<referral_tree_node> get_referral_tree_node( const std::string account_id_or_name )const;
       vector<optional<account_object>> lookup_account_names(const vector<string>& account_names)const;
       map<string,account_id_type> lookup_accounts(const string& lower_bound_name, uint32_t limit)const;
       uint64_t get_account_count()const;
@@ -196,6 +340,39 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       // GREAT RACE //
       ////////////////
       vector<gr_rating_obj> gr_get_rating(const std::string rating_type) const; // rating_type in ['race', 'stage', 'current_interval', 'prev_interval']
+      uint64_t gr_get_team_place(const std::string& rating_type, const gr_team_id_type team_id) const;
+      gr_rating_volume gr_get_rating_volume(const std::string& rating_type) const;
+
+      /// The first @p limit teams of the rating kept by the volume index @p Tag, best first
+      template<typename Tag>
+      vector<gr_rating_obj> gr_get_top_teams(share_type gr_team_object::* volume, uint64_t limit) const
+      {
+         const auto& rating_idx = _db.get_index_type<gr_team_index>().indices().get<Tag>();
+         vector<gr_rating_obj> result;
+         result.reserve(std::min<uint64_t>(limit, rating_idx.size()));
+         uint64_t place = 1;
+         for (auto team_itr = rating_idx.rbegin(); team_itr != rating_idx.rend() && place <= limit; ++team_itr, ++place)
+         {
+            const gr_team_object& team = *team_itr;
+            gr_rating_obj gr_rating_obj_team;
+            gr_rating_obj_team.team_id = team.id;
+            gr_rating_obj_team.place_num = place;
+            gr_rating_obj_team.img = team.logo;
+            gr_rating_obj_team.name = team.name;
+            gr_rating_obj_team.players = team.players.size()+1;
+            gr_rating_obj_team.volume = team.*volume;
+            result.emplace_back(std::move(gr_rating_obj_team));
+         }
+         return result;
+      }
+
+      /// Place of @p team in the rating kept by the ranked volume index @p Tag, 1 for the highest volume
+      template<typename Tag>
+      uint64_t gr_get_place(const gr_team_object& team) const
+      {
+         const auto& rating_idx = _db.get_index_type<gr_team_index>().indices().get<Tag>();
+         return rating_idx.size() - rating_idx.rank(rating_idx.iterator_to(team));
+      }
       vector<gr_invite_obj> gr_get_invites(const std::string account_id_or_name) const;
       vector<gr_range_bet_api_obj> gr_get_range_bets() const;
       vector<gr_team_bet_api_obj> gr_get_team_bets() const;
@@ -210,7 +387,18 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
             return;
 
          if( !is_subscribed_to_item(i) )
+         {
+            vector<size_t> bits;
+            _subscribe_filter.compute_bits( reinterpret_cast<const unsigned char*>( vec.data() ), vec.size(), bits );
+            bits.erase( std::remove_if( bits.begin(), bits.end(), [this]( size_t bit ) {
+               return _subscribe_filter.contains_bit( bit );
+            }), bits.end() );
+            std::sort( bits.begin(), bits.end() );
+            bits.erase( std::unique( bits.begin(), bits.end() ), bits.end() );
+            subscription_filter_union::instance().add( bits );
+            _subscribed_bits.insert( _subscribed_bits.end(), bits.begin(), bits.end() );
             _subscribe_filter.insert( vec.data(), vec.size() );
+         }
       }
 
       template<typename T>
@@ -227,6 +415,11 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
          if( !_subscribed_accounts.size() || !accounts.size() )
             return false;
 
+         // look the smaller set up in the larger one
+         if( _subscribed_accounts.size() < accounts.size() )
+            return std::any_of(_subscribed_accounts.begin(), _subscribed_accounts.end(), [&accounts](const account_id_type& account) {
+               return accounts.find(account) != accounts.end();
+            });
          return std::any_of(accounts.begin(), accounts.end(), [this](const account_id_type& account) {
             return _subscribed_accounts.find(account) != _subscribed_accounts.end();
          });
@@ -329,7 +522,7 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       }
 
       template<typename T>
-      void enqueue_if_subscribed_to_market(const object* obj, market_queue_type& queue, bool full_object=true)
+      void enqueue_if_subscribed_to_market(const object* obj, market_queue_type& queue, const std::function<fc::variant()>& make_update)
       {
          const T* order = dynamic_cast<const T*>(obj);
          FC_ASSERT( order != nullptr);
@@ -338,30 +531,31 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 
          auto sub = _market_subscriptions.find( market );
          if( sub != _market_subscriptions.end() ) {
-            queue[market].emplace_back( full_object ? obj->to_variant() : fc::variant(obj->id, 1) );
+            queue[market].emplace_back( make_update() );
          }
       }
 
       void broadcast_updates( const vector<variant>& updates );
       void broadcast_market_updates( const market_queue_type& queue);
-      void handle_object_changed(bool force_notify, bool full_object, const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts, std::function<const object*(object_id_type id)> find_object);
+      void handle_object_changed(bool force_notify, bool full_object, change_set_cache& cache, change_set_cache::group group,
+                                 const vector<object_id_type>& ids, const vector<const object*>& objs,
+                                 const flat_set<account_id_type>& impacted_accounts,
+                                 vector<variant>& updates, market_queue_type& market_queue);
 
-      /** called every time a block is applied to report the objects that were changed */
-      void on_objects_new(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts);
-      void on_objects_changed(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts);
-      void on_objects_removed(const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts);
+      /** called every time a block is applied to report the objects that were created, changed and removed */
+      void on_objects_changed(const std::shared_ptr<const object_change_set>& changes);
       void on_applied_block();
 
       bool _notify_remove_create = false;
       mutable fc::bloom_filter _subscribe_filter;
+      /// the bits this session counts in subscription_filter_union
+      mutable vector<size_t> _subscribed_bits;
       std::set<account_id_type> _subscribed_accounts;
       std::function<void(const fc::variant&)> _subscribe_callback;
       std::function<void(const fc::variant&)> _pending_trx_callback;
       std::function<void(const fc::variant&)> _block_applied_callback;
 
-      boost::signals2::scoped_connection                                                                                           _new_connection;
       boost::signals2::scoped_connection                                                                                           _change_connection;
-      boost::signals2::scoped_connection                                                                                           _removed_connection;
       boost::signals2::scoped_connection                                                                                           _applied_block_connection;
       boost::signals2::scoped_connection                                                                                           _pending_trx_connection;
       map< pair<asset_id_type,asset_id_type>, std::function<void(const variant&)> >      _market_subscriptions;
@@ -384,14 +578,8 @@ database_api_impl::database_api_impl( graphene::chain::database& db, const appli
 :_db(db), _app_options(app_options)
 {
    // ilog("creating database api ${x}", ("x",int64_t(this)) );
-   _new_connection = _db.new_objects.connect([this](const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts) {
-                                on_objects_new(ids, impacted_accounts);
-                                });
-   _change_connection = _db.changed_objects.connect([this](const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts) {
-                                on_objects_changed(ids, impacted_accounts);
-                                });
-   _removed_connection = _db.removed_objects.connect([this](const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts) {
-                                on_objects_removed(ids, objs, impacted_accounts);
+   _change_connection = _db.object_changes.connect([this](const std::shared_ptr<const object_change_set>& changes) {
+                                on_objects_changed(changes);
                                 });
    _applied_block_connection = _db.applied_block.connect([this](const signed_block&){ on_applied_block(); });
 
@@ -403,6 +591,7 @@ database_api_impl::database_api_impl( graphene::chain::database& db, const appli
 database_api_impl::~database_api_impl()
 {
    // ilog("freeing database api ${x}", ("x",int64_t(this)) );
+   subscription_filter_union::instance().remove( _subscribed_bits );
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -566,8 +755,9 @@ void database_api_impl::cancel_all_subscriptions( bool reset_callback, bool rese
 
    _notify_remove_create = false;
    _subscribed_accounts.clear();
-   static fc::bloom_parameters param(10000, 1.0/100, 1024*8*8*2);
-   _subscribe_filter = fc::bloom_filter(param);
+   subscription_filter_union::instance().remove( _subscribed_bits );
+   _subscribed_bits.clear();
+   _subscribe_filter = fc::bloom_filter(subscription_filter_parameters());
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -920,87 +1110,95 @@ std::map<std::string, full_account> database_api_impl::get_full_accounts( const
 
    std::map<std::string, full_account> results;
 
-   for (const std::string& account_name_or_id : names_or_ids)
-   {
-      const account_object* account = get_account_from_string(account_name_or_id);
-      if (account == nullptr)
-         continue;
-
-      if( subscribe )
+   _db.read_state( [&]() {
+      for (const std::string& account_name_or_id : names_or_ids)
       {
-         if(_subscribed_accounts.size() < 100) {
-            _subscribed_accounts.insert( account->get_id() );
-            subscribe_to_item( account->id );
+         const account_object* account = get_account_from_string(account_name_or_id);
+         if (account == nullptr)
+            continue;
+
+         full_account acnt;
+         acnt.account = *account;
+         acnt.statistics = account->statistics(_db);
+         acnt.registrar_name = account->registrar(_db).name;
+         acnt.referrer_name = account->referrer(_db).name;
+         acnt.lifetime_referrer_name = account->lifetime_referrer(_db).name;
+         acnt.votes = lookup_vote_ids( vector<vote_id_type>(account->options.votes.begin(),account->options.votes.end()) );
+
+         if (account->cashback_vb)
+         {
+            acnt.cashback_balance = account->cashback_balance(_db);
+         }
+         // Add the account's proposals
+         auto  required_approvals_itr = proposals_by_account._account_to_proposals.find( account->id );
+         if( required_approvals_itr != proposals_by_account._account_to_proposals.end() )
+         {
+            acnt.proposals.reserve( required_approvals_itr->second.size() );
+            for( auto proposal_id : required_approvals_itr->second )
+               acnt.proposals.push_back( proposal_id(_db) );
          }
-      }
 
-      full_account acnt;
-      acnt.account = *account;
-      acnt.statistics = account->statistics(_db);
-      acnt.registrar_name = account->registrar(_db).name;
-      acnt.referrer_name = account->referrer(_db).name;
-      acnt.lifetime_referrer_name = account->lifetime_referrer(_db).name;
-      acnt.votes = lookup_vote_ids( vector<vote_id_type>(account->options.votes.begin(),account->options.votes.end()) );
 
-      if (account->cashback_vb)
-      {
-         acnt.cashback_balance = account->cashback_balance(_db);
+         // Add the account's balances
+         const auto& balances = _db.get_index_type< primary_index< account_balance_index > >().get_secondary_index< balances_by_account_index >().get_account_balances( account->id );
+         for( const auto balance : balances )
+            acnt.balances.emplace_back( *balance.second );
+
+         // Add the account's vesting balances
+         auto vesting_range = _db.get_index_type<vesting_balance_index>().indices().get<by_account>().equal_range(account->id);
+         std::for_each(vesting_range.first, vesting_range.second,
+                       [&acnt](const vesting_balance_object& balance) {
+                          acnt.vesting_balances.emplace_back(balance);
+                       });
+
+         // Add the account's orders
+         auto order_range = _db.get_index_type<limit_order_index>().indices().get<by_account>().equal_range(account->id);
+         std::for_each(order_range.first, order_range.second,
+                       [&acnt] (const limit_order_object& order) {
+                          acnt.limit_orders.emplace_back(order);
+                       });
+         auto call_range = _db.get_index_type<call_order_index>().indices().get<by_account>().equal_range(account->id);
+         std::for_each(call_range.first, call_range.second,
+                       [&acnt] (const call_order_object& call) {
+                          acnt.call_orders.emplace_back(call);
+                       });
+         auto settle_range = _db.get_index_type<force_settlement_index>().indices().get<by_account>().equal_range(account->id);
+         std::for_each(settle_range.first, settle_range.second,
+                       [&acnt] (const force_settlement_object& settle) {
+                          acnt.settle_orders.emplace_back(settle);
+                       });
+
+         // get assets issued by user
+         auto asset_range = _db.get_index_type<asset_index>().indices().get<by_issuer>().equal_range(account->id);
+         std::for_each(asset_range.first, asset_range.second,
+                       [&acnt] (const asset_object& asset) {
+                          acnt.assets.emplace_back(asset.id);
+                       });
+
+         // get withdraws permissions
+         auto withdraw_range = _db.get_index_type<withdraw_permission_index>().indices().get<by_from>().equal_range(account->id);
+         std::for_each(withdraw_range.first, withdraw_range.second,
+                       [&acnt] (const withdraw_permission_object& withdraw) {
+                          acnt.withdraws.emplace_back(withdraw);
+                       });
+
+
+         results[account_name_or_id] = acnt;
       }
-      // Add the account's proposals
-      auto  required_approvals_itr = proposals_by_account._account_to_proposals.find( account->id );
-      if( required_approvals_itr != proposals_by_account._account_to_proposals.end() )
+   });
+
+   // subscriptions belong to this session, they are only touched on the calling thread
+   if( subscribe )
+   {
+      for( const std::string& account_name_or_id : names_or_ids )
       {
-         acnt.proposals.reserve( required_approvals_itr->second.size() );
-         for( auto proposal_id : required_approvals_itr->second )
-            acnt.proposals.push_back( proposal_id(_db) );
+         auto itr = results.find( account_name_or_id );
+         if( itr != results.end() && _subscribed_accounts.size() < 100 )
+         {
+            _subscribed_accounts.insert( itr->second.account.get_id() );
+            subscribe_to_item( itr->second.account.id );
+         }
       }
-
-
-      // Add the account's balances
-      const auto& balances = _db.get_index_type< primary_index< account_balance_index > >().get_secondary_index< balances_by_account_index >().get_account_balances( account->id );
-      for( const auto balance : balances )
-         acnt.balances.emplace_back( *balance.second );
-
-      // Add the account's vesting balances
-      auto vesting_range = _db.get_index_type<vesting_balance_index>().indices().get<by_account>().equal_range(account->id);
-      std::for_each(vesting_range.first, vesting_range.second,
-                    [&acnt](const vesting_balance_object& balance) {
-                       acnt.vesting_balances.emplace_back(balance);
-                    });
-
-      // Add the account's orders
-      auto order_range = _db.get_index_type<limit_order_index>().indices().get<by_account>().equal_range(account->id);
-      std::for_each(order_range.first, order_range.second,
-                    [&acnt] (const limit_order_object& order) {
-                       acnt.limit_orders.emplace_back(order);
-                    });
-      auto call_range = _db.get_index_type<call_order_index>().indices().get<by_account>().equal_range(account->id);
-      std::for_each(call_range.first, call_range.second,
-                    [&acnt] (const call_order_object& call) {
-                       acnt.call_orders.emplace_back(call);
-                    });
-      auto settle_range = _db.get_index_type<force_settlement_index>().indices().get<by_account>().equal_range(account->id);
-      std::for_each(settle_range.first, settle_range.second,
-                    [&acnt] (const force_settlement_object& settle) {
-                       acnt.settle_orders.emplace_back(settle);
-                    });
-
-      // get assets issued by user
-      auto asset_range = _db.get_index_type<asset_index>().indices().get<by_issuer>().equal_range(account->id);
-      std::for_each(asset_range.first, asset_range.second,
-                    [&acnt] (const asset_object& asset) {
-                       acnt.assets.emplace_back(asset.id);
-                    });
-
-      // get withdraws permissions
-      auto withdraw_range = _db.get_index_type<withdraw_permission_index>().indices().get<by_from>().equal_range(account->id);
-      std::for_each(withdraw_range.first, withdraw_range.second,
-                    [&acnt] (const withdraw_permission_object& withdraw) {
-                       acnt.withdraws.emplace_back(withdraw);
-                    });
-
-
-      results[account_name_or_id] = acnt;
    }
    return results;
 }
@@ -1041,6 +1239,23 @@ vector<account_id_type> database_api_impl::get_account_references( const std::st
    return result;
 }
 
+optional<referral_tree_node> database_api::get_referral_tree_node( const std::string account_id_or_name )const
+{
+   return my->get_referral_tree_node( account_id_or_name );
+}
+
+optional<referral_tree_node> database_api_impl::get_referral_tree_node( const std::string account_id_or_name )const
+{
+   const auto& idx = _db.get_index_type<account_index>();
+   const auto& aidx = dynamic_cast<const base_primary_index&>(idx);
+   const auto& refs = aidx.get_secondary_index<graphene::chain::account_referrer_index>();
+   const account_id_type account_id = get_account_from_string(account_id_or_name)->id;
+   const referral_tree_node* node = refs.find_node(account_id);
+   if( node == nullptr )
+      return {};
+   return *node;
+}
+
 vector<optional<account_object>> database_api::lookup_account_names(const vector<string>& account_names)const
 {
    return my->lookup_account_names( account_names );
@@ -1508,7 +1723,9 @@ market_volume database_api_impl::get_24_volume( const string& base, const string
 
 order_book database_api::get_order_book( const string& base, const string& quote, unsigned limit )const
 {
-   return my->get_order_book( base, quote, limit);
+   order_book result;
+   my->_db.read_state( [&]() { result = my->get_order_book( base, quote, limit ); } );
+   return result;
 }
 
 order_book database_api_impl::get_order_book( const string& base, const string& quote, unsigned limit )const
@@ -1587,7 +1804,9 @@ vector<market_trade> database_api::get_trade_history( const string& base,
                                                       fc::time_point_sec stop,
                                                       unsigned limit )const
 {
-   return my->get_trade_history( base, quote, start, stop, limit );
+   vector<market_trade> result;
+   my->_db.read_state( [&]() { result = my->get_trade_history( base, quote, start, stop, limit ); } );
+   return result;
 }
 
 vector<market_trade> database_api_impl::get_trade_history( const string& base,
@@ -1677,7 +1896,9 @@ vector<market_trade> database_api::get_trade_history_by_sequence(
                                                       fc::time_point_sec stop,
                                                       unsigned limit )const
 {
-   return my->get_trade_history_by_sequence( base, quote, start, stop, limit );
+   vector<market_trade> result;
+   my->_db.read_state( [&]() { result = my->get_trade_history_by_sequence( base, quote, start, stop, limit ); } );
+   return result;
 }
 
 vector<market_trade> database_api_impl::get_trade_history_by_sequence(
@@ -2925,231 +3146,90 @@ vector<gr_rating_obj> database_api::gr_get_rating(const std::string rating_type)
    return my->gr_get_rating(rating_type);
 }
 
-vector<gr_rating_obj> database_api_impl::gr_get_rating(const std::string rating_type) const
+uint64_t database_api::gr_get_team_place(const std::string rating_type, const gr_team_id_type team_id) const {
+   return my->gr_get_team_place(rating_type, team_id);
+}
+
+gr_rating_volume database_api_impl::gr_get_rating_volume(const std::string& rating_type) const
 {
-   uint64_t limit = 100;
-   vector<gr_rating_obj> result;
    const dynamic_global_property_object& dgpo = _db.get(dynamic_global_property_id_type());
 
-   if (rating_type == "race") {
-      auto& rating_idx = _db.get_index_type<gr_team_index>().indices().get<by_total_volume>();
-      uint64_t place=1;
-      auto team_itr = rating_idx.rbegin();
-
-      while( team_itr != rating_idx.rend() && place <= limit)
-      {
-         gr_rating_obj gr_rating_obj_team;
-         gr_team_object team = *team_itr;
-         gr_rating_obj_team.team_id = team.id;
-         gr_rating_obj_team.place_num = place;
-         gr_rating_obj_team.img = team.logo;
-         gr_rating_obj_team.name = team.name;
-         gr_rating_obj_team.players = team.players.size()+1;
-         gr_rating_obj_team.volume = team.total_volume;
-         result.emplace_back(gr_rating_obj_team);
-         place++;
-         ++team_itr;
-      } 
-   }
-   if (rating_type == "stage" && dgpo.current_gr_interval < 8) {
-      auto& rating_idx = _db.get_index_type<gr_team_index>().indices().get<by_total_first_half_volume>();
-      uint64_t place=1;
-      auto team_itr = rating_idx.rbegin();
-
-      while( team_itr != rating_idx.rend() && place <= limit)
-      {
-         gr_rating_obj gr_rating_obj_team;
-         gr_team_object team = *team_itr;
-         gr_rating_obj_team.team_id = team.id;
-         gr_rating_obj_team.place_num = place;
-         gr_rating_obj_team.img = team.logo;
-         gr_rating_obj_team.name = team.name;
-         gr_rating_obj_team.players = team.players.size()+1;
-         gr_rating_obj_team.volume = team.first_half_volume;
-         result.emplace_back(gr_rating_obj_team);
-         place++;
-         ++team_itr;
-      } 
+   if (rating_type == "race")
+      return gr_rating_volume::total;
+   if (rating_type == "stage")
+      return dgpo.current_gr_interval < 8 ? gr_rating_volume::first_half : gr_rating_volume::second_half;
+   if (rating_type != "current_interval" && rating_type != "prev_interval")
+      return gr_rating_volume::none;
+
+   const bool prev = rating_type == "prev_interval";
+   switch (dgpo.current_gr_interval) {
+      case 4: case 5:
+         return prev ? gr_rating_volume::interval_2 : gr_rating_volume::interval_4;
+      case 6: case 7: case 8:
+         return prev ? gr_rating_volume::interval_4 : gr_rating_volume::interval_6;
+      case 9: case 10:
+         return prev ? gr_rating_volume::interval_6 : gr_rating_volume::interval_9;
+      case 11: case 12:
+         return prev ? gr_rating_volume::interval_9 : gr_rating_volume::interval_11;
+      case 13: case 14:
+         return prev ? gr_rating_volume::interval_11 : gr_rating_volume::interval_13;
+      default:
+         return gr_rating_volume::interval_2;
    }
-   if (rating_type == "stage" && dgpo.current_gr_interval >= 8) {
-      auto& rating_idx = _db.get_index_type<gr_team_index>().indices().get<by_total_second_half_volume>();
-      uint64_t place=1;
-      auto team_itr = rating_idx.rbegin();
+}
 
-      while( team_itr != rating_idx.rend() && place <= limit)
-      {
-         gr_rating_obj gr_rating_obj_team;
-         gr_team_object team = *team_itr;
-         gr_rating_obj_team.team_id = team.id;
-         gr_rating_obj_team.place_num = place;
-         gr_rating_obj_team.img = team.logo;
-         gr_rating_obj_team.name = team.name;
-         gr_rating_obj_team.players = team.players.size()+1;
-         gr_rating_obj_team.volume = team.second_half_volume;
-         result.emplace_back(gr_rating_obj_team);
-         place++;
-         ++team_itr;
-      } 
+vector<gr_rating_obj> database_api_impl::gr_get_rating(const std::string rating_type) const
+{
+   const uint64_t limit = 100;
+   switch (gr_get_rating_volume(rating_type)) {
+      case gr_rating_volume::total:
+         return gr_get_top_teams<by_total_volume>(&gr_team_object::total_volume, limit);
+      case gr_rating_volume::first_half:
+         return gr_get_top_teams<by_total_first_half_volume>(&gr_team_object::first_half_volume, limit);
+      case gr_rating_volume::second_half:
+         return gr_get_top_teams<by_total_second_half_volume>(&gr_team_object::second_half_volume, limit);
+      case gr_rating_volume::interval_2:
+         return gr_get_top_teams<by_gr_interval_2_volume>(&gr_team_object::gr_interval_2_volume, limit);
+      case gr_rating_volume::interval_4:
+         return gr_get_top_teams<by_gr_interval_4_volume>(&gr_team_object::gr_interval_4_volume, limit);
+      case gr_rating_volume::interval_6:
+         return gr_get_top_teams<by_gr_interval_6_volume>(&gr_team_object::gr_interval_6_volume, limit);
+      case gr_rating_volume::interval_9:
+         return gr_get_top_teams<by_gr_interval_9_volume>(&gr_team_object::gr_interval_9_volume, limit);
+      case gr_rating_volume::interval_11:
+         return gr_get_top_teams<by_gr_interval_11_volume>(&gr_team_object::gr_interval_11_volume, limit);
+      case gr_rating_volume::interval_13:
+         return gr_get_top_teams<by_gr_interval_13_volume>(&gr_team_object::gr_interval_13_volume, limit);
+      default:
+         return vector<gr_rating_obj>();
    }
-   if (rating_type == "current_interval" || rating_type == "prev_interval") {
-      uint8_t needed_interval = 2;
-      if (dgpo.current_gr_interval == 1 || dgpo.current_gr_interval == 2 || dgpo.current_gr_interval == 3) {
-         needed_interval = 2;
-      }
-      if (dgpo.current_gr_interval == 4 || dgpo.current_gr_interval == 5) {
-         needed_interval = 4;
-         if (rating_type == "prev_interval") {
-               needed_interval = 2;
-         }
-      }
-      if (dgpo.current_gr_interval == 6 || dgpo.current_gr_interval == 7 || dgpo.current_gr_interval == 8) {
-         needed_interval = 6;
-         if (rating_type == "prev_interval") {
-               needed_interval = 4;
-         }
-      }      
-      if (dgpo.current_gr_interval == 9 || dgpo.current_gr_interval == 10 ) {
-         needed_interval = 9;
-         if (rating_type == "prev_interval") {
-               needed_interval = 6;
-         }
-      } 
-      if (dgpo.current_gr_interval == 11 || dgpo.current_gr_interval == 12 ) {
-         needed_interval = 11;
-         if (rating_type == "prev_interval") {
-               needed_interval = 9;
-         }
-      }
-      if (dgpo.current_gr_interval == 13 || dgpo.current_gr_interval == 14 ) {
-         needed_interval = 13;
-         if (rating_type == "prev_interval") {
-               needed_interval = 11;
-         }
-      }
-
-      if (needed_interval == 2) {
-         auto& rating_idx = _db.get_index_type<gr_team_index>().indices().get<by_gr_interval_2_volume>();
-         uint64_t place=1;
-         auto team_itr = rating_idx.rbegin();
-
-         while( team_itr != rating_idx.rend() && place <= limit)
-         {
-            gr_rating_obj gr_rating_obj_team;
-            gr_team_object team = *team_itr;
-            gr_rating_obj_team.team_id = team.id;
-            gr_rating_obj_team.place_num = place;
-            gr_rating_obj_team.img = team.logo;
-            gr_rating_obj_team.name = team.name;
-            gr_rating_obj_team.players = team.players.size()+1;
-            gr_rating_obj_team.volume = team.gr_interval_2_volume;
-            result.emplace_back(gr_rating_obj_team);
-            place++;
-            ++team_itr;
-         } 
-      }
-      if (needed_interval == 4) {
-         auto& rating_idx = _db.get_index_type<gr_team_index>().indices().get<by_gr_interval_4_volume>();
-         uint64_t place=1;
-         auto team_itr = rating_idx.rbegin();
-
-         while( team_itr != rating_idx.rend() && place <= limit)
-         {
-            gr_rating_obj gr_rating_obj_team;
-            gr_team_object team = *team_itr;
-            gr_rating_obj_team.team_id = team.id;
-            gr_rating_obj_team.place_num = place;
-            gr_rating_obj_team.img = team.logo;
-            gr_rating_obj_team.name = team.name;
-            gr_rating_obj_team.players = team.players.size()+1;
-            gr_rating_obj_team.volume = team.gr_interval_4_volume;
-            result.emplace_back(gr_rating_obj_team);
-            place++;
-            ++team_itr;
-         } 
-      }
-      if (needed_interval == 6) {
-         auto& rating_idx = _db.get_index_type<gr_team_index>().indices().get<by_gr_interval_6_volume>();
-         uint64_t place=1;
-         auto team_itr = rating_idx.rbegin();
-
-         while( team_itr != rating_idx.rend() && place <= limit)
-         {
-            gr_rating_obj gr_rating_obj_team;
-            gr_team_object team = *team_itr;
-            gr_rating_obj_team.team_id = team.id;
-            gr_rating_obj_team.place_num = place;
-            gr_rating_obj_team.img = team.logo;
-            gr_rating_obj_team.name = team.name;
-            gr_rating_obj_team.players = team.players.size()+1;
-            gr_rating_obj_team.volume = team.gr_interval_6_volume;
-            result.emplace_back(gr_rating_obj_team);
-            place++;
-            ++team_itr;
-         } 
-      }
-      if (needed_interval == 9) {
-         auto& rating_idx = _db.get_index_type<gr_team_index>().indices().get<by_gr_interval_9_volume>();
-         uint64_t place=1;
-         auto team_itr = rating_idx.rbegin();
-
-         while( team_itr != rating_idx.rend() && place <= limit)
-         {
-            gr_rating_obj gr_rating_obj_team;
-            gr_team_object team = *team_itr;
-            gr_rating_obj_team.team_id = team.id;
-            gr_rating_obj_team.place_num = place;
-            gr_rating_obj_team.img = team.logo;
-            gr_rating_obj_team.name = team.name;
-            gr_rating_obj_team.players = team.players.size()+1;
-            gr_rating_obj_team.volume = team.gr_interval_9_volume;
-            result.emplace_back(gr_rating_obj_team);
-            place++;
-            ++team_itr;
-         } 
-      }
-      if (needed_interval == 11) {
-         auto& rating_idx = _db.get_index_type<gr_team_index>().indices().get<by_gr_interval_11_volume>();
-         uint64_t place=1;
-         auto team_itr = rating_idx.rbegin();
-
-         while( team_itr != rating_idx.rend() && place <= limit)
-         {
-            gr_rating_obj gr_rating_obj_team;
-            gr_team_object team = *team_itr;
-            gr_rating_obj_team.team_id = team.id;
-            gr_rating_obj_team.place_num = place;
-            gr_rating_obj_team.img = team.logo;
-            gr_rating_obj_team.name = team.name;
-            gr_rating_obj_team.players = team.players.size()+1;
-            gr_rating_obj_team.volume = team.gr_interval_11_volume;
-            result.emplace_back(gr_rating_obj_team);
-            place++;
-            ++team_itr;
-         } 
-      }
-      if (needed_interval == 13) {
-         auto& rating_idx = _db.get_index_type<gr_team_index>().indices().get<by_gr_interval_13_volume>();
-         uint64_t place=1;
-         auto team_itr = rating_idx.rbegin();
+}
 
-         while( team_itr != rating_idx.rend() && place <= limit)
-         {
-            gr_rating_obj gr_rating_obj_team;
-            gr_team_object team = *team_itr;
-            gr_rating_obj_team.team_id = team.id;
-            gr_rating_obj_team.place_num = place;
-            gr_rating_obj_team.img = team.logo;
-            gr_rating_obj_team.name = team.name;
-            gr_rating_obj_team.players = team.players.size()+1;
-            gr_rating_obj_team.volume = team.gr_interval_13_volume;
-            result.emplace_back(gr_rating_obj_team);
-            place++;
-            ++team_itr;
-         } 
-      }
+uint64_t database_api_impl::gr_get_team_place(const std::string& rating_type, const gr_team_id_type team_id) const
+{
+   const gr_team_object& team = team_id(_db);
+   switch (gr_get_rating_volume(rating_type)) {
+      case gr_rating_volume::total:
+         return gr_get_place<by_total_volume>(team);
+      case gr_rating_volume::first_half:
+         return gr_get_place<by_total_first_half_volume>(team);
+      case gr_rating_volume::second_half:
+         return gr_get_place<by_total_second_half_volume>(team);
+      case gr_rating_volume::interval_2:
+         return gr_get_place<by_gr_interval_2_volume>(team);
+      case gr_rating_volume::interval_4:
+         return gr_get_place<by_gr_interval_4_volume>(team);
+      case gr_rating_volume::interval_6:
+         return gr_get_place<by_gr_interval_6_volume>(team);
+      case gr_rating_volume::interval_9:
+         return gr_get_place<by_gr_interval_9_volume>(team);
+      case gr_rating_volume::interval_11:
+         return gr_get_place<by_gr_interval_11_volume>(team);
+      case gr_rating_volume::interval_13:
+         return gr_get_place<by_gr_interval_13_volume>(team);
+      default:
+         FC_THROW_EXCEPTION( fc::invalid_arg_exception, "Unknown rating type ${t}", ("t", rating_type) );
    }
-
-   return result;
 }
 
 
@@ -3256,87 +3336,77 @@ void database_api_impl::broadcast_market_updates( const market_queue_type& queue
    }
 }
 
-void database_api_impl::on_objects_removed( const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts)
+void database_api_impl::on_objects_changed(const std::shared_ptr<const object_change_set>& changes)
 {
-   handle_object_changed(_notify_remove_create, false, ids, impacted_accounts,
-      [objs](object_id_type id) -> const object* {
-         auto it = std::find_if(
-               objs.begin(), objs.end(),
-               [id](const object* o) {return o != nullptr && o->id == id;});
-
-         if (it != objs.end())
-            return *it;
-
-         return nullptr;
-      }
-   );
-}
+   if( !_subscribe_callback && _market_subscriptions.empty() )
+      return;
 
-void database_api_impl::on_objects_new(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts)
-{
-   handle_object_changed(_notify_remove_create, true, ids, impacted_accounts,
-      std::bind(&object_database::find_object, &_db, std::placeholders::_1)
-   );
-}
+   // everything this session gets from the change set is sent in one update and one market update
+   change_set_cache& cache = change_set_cache::get( changes );
+   vector<variant> updates;
+   market_queue_type market_queue;
+   handle_object_changed(_notify_remove_create, true, cache, change_set_cache::new_objects,
+                         changes->new_ids, changes->new_objects, changes->new_accounts_impacted,
+                         updates, market_queue);
+   handle_object_changed(false, true, cache, change_set_cache::changed_objects,
+                         changes->changed_ids, changes->changed_objects, changes->changed_accounts_impacted,
+                         updates, market_queue);
+   handle_object_changed(_notify_remove_create, false, cache, change_set_cache::removed_objects,
+                         changes->removed_ids, changes->removed_objects, changes->removed_accounts_impacted,
+                         updates, market_queue);
+
+   if( updates.size() )
+      broadcast_updates(updates);
+   if( market_queue.size() )
+      broadcast_market_updates(market_queue);
+}
+
+void database_api_impl::handle_object_changed(bool force_notify, bool full_object, change_set_cache& cache, change_set_cache::group group,
+                                              const vector<object_id_type>& ids, const vector<const object*>& objs,
+                                              const flat_set<account_id_type>& impacted_accounts,
+                                              vector<variant>& updates, market_queue_type& market_queue)
+{
+   if( ids.empty() )
+      return;
 
-void database_api_impl::on_objects_changed(const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts)
-{
-   handle_object_changed(false, true, ids, impacted_accounts,
-      std::bind(&object_database::find_object, &_db, std::placeholders::_1)
-   );
-}
+   auto make_update = [&]( size_t i ) -> fc::variant {
+      return full_object ? cache.object_variant( group, i, *objs[i] ) : fc::variant( ids[i], 1 );
+   };
 
-void database_api_impl::handle_object_changed(bool force_notify, bool full_object, const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts, std::function<const object*(object_id_type id)> find_object)
-{
    if( _subscribe_callback )
    {
-      vector<variant> updates;
-
-      for(auto id : ids)
+      if( force_notify || is_impacted_account(impacted_accounts) )
       {
-         if( force_notify || is_subscribed_to_item(id) || is_impacted_account(impacted_accounts) )
-         {
-            if( full_object )
-            {
-               auto obj = find_object(id);
-               if( obj )
-               {
-                  updates.emplace_back( obj->to_variant() );
-               }
-            }
-            else
-            {
-               updates.emplace_back( fc::variant( id, 1 ) );
-            }
-         }
+         for( size_t i = 0; i < ids.size(); ++i )
+            if( !full_object || objs[i] )
+               updates.emplace_back( make_update( i ) );
+      }
+      else
+      {
+         // only the ids that some session subscribed to can be in the filter of this one
+         for( const auto& candidate : cache.candidates( group, _subscribe_filter ) )
+            if( _subscribe_filter.contains_bits( candidate.bits ) && ( !full_object || objs[candidate.index] ) )
+               updates.emplace_back( make_update( candidate.index ) );
       }
-
-      if( updates.size() )
-         broadcast_updates(updates);
    }
 
    if( _market_subscriptions.size() )
    {
-      market_queue_type broadcast_queue;
-
-      for(auto id : ids)
+      for( size_t i = 0; i < ids.size(); ++i )
       {
-         if( id.is<call_order_object>() )
+         if( ids[i].is<call_order_object>() )
          {
-            enqueue_if_subscribed_to_market<call_order_object>( find_object(id), broadcast_queue, full_object );
+            enqueue_if_subscribed_to_market<call_order_object>( objs[i], market_queue, [&]{ return make_update( i ); } );
          }
-         else if( id.is<limit_order_object>() )
+         else if( ids[i].is<limit_order_object>() )
          {
-            enqueue_if_subscribed_to_market<limit_order_object>( find_object(id), broadcast_queue, full_object );
+            enqueue_if_subscribed_to_market<limit_order_object>( objs[i], market_queue, [&]{ return make_update( i ); } );
          }
-         else if( id.is<force_settlement_object>() )
+         else if( ids[i].is<force_settlement_object>() )
          {
-            enqueue_if_subscribed_to_market<force_settlement_object>( find_object(id), broadcast_queue, full_object );
+            enqueue_if_subscribed_to_market<force_settlement_object>( objs[i], market_queue, [&]{ return make_update( i ); } );
          }
       }
-
-      if( broadcast_queue.size() )
-         broadcast_market_updates(broadcast_queue);
    }
 }
 
@@ -504,6 +504,37 @@ namespace graphene { namespace app {
          graphene::app::database_api database_api;
    };
 
+   /**
+    * @brief The metrics_api class exposes the latency statistics of the block profiler
+    *
+    * Statistics are only collected while the node runs with enable-profiling.
+    */
+   class metrics_api
+   {
+      public:
+         metrics_api(graphene::chain::database& db):_db(db){}
+
+         /**
+          * @brief Get the latency of the stages of block application
+          * @return One entry per stage, in the order they are applied
+          */
+         vector<graphene::chain::profile_summary> get_block_stage_profile()const;
+
+         /**
+          * @brief Get the latency of operations per operation type
+          * @return One entry per operation type and phase (evaluate, apply and total) that was seen
+          */
+         vector<graphene::chain::profile_summary> get_operation_profile()const;
+
+         /**
+          * @brief Drop the statistics collected so far
+          */
+         void reset_profile();
+
+      private:
+         graphene::chain::database& _db;
+   };
+
    /**
     * @brief The login_api class implements the bottom layer of the RPC API
     *
@@ -541,6 +572,8 @@ namespace graphene { namespace app {
          fc::api<asset_api> asset()const;
          /// @brief Retrieve the orders API
          fc::api<orders_api> orders()const;
+         /// @brief Retrieve the metrics API
+         fc::api<metrics_api> metrics()const;
          /// @brief Retrieve the debug API (if available)
          fc::api<graphene::debug_witness::debug_api> debug()const;
 
@@ -557,6 +590,7 @@ namespace graphene { namespace app {
          optional< fc::api<crypto_api> > _crypto_api;
          optional< fc::api<asset_api> > _asset_api;
          optional< fc::api<orders_api> > _orders_api;
+         optional< fc::api<metrics_api> > _metrics_api;
          optional< fc::api<graphene::debug_witness::debug_api> > _debug_api;
    };
 
@@ -622,6 +656,11 @@ FC_API(graphene::app::orders_api,
        (get_tracked_groups)
        (get_grouped_limit_orders)
      )
+FC_API(graphene::app::metrics_api,
+       (get_block_stage_profile)
+       (get_operation_profile)
+       (reset_profile)
+     )
 FC_API(graphene::app::login_api,
        (login)
        (block)
@@ -632,5 +671,6 @@ FC_API(graphene::app::login_api,
        (crypto)
        (asset)
        (orders)
+       (metrics)
        (debug)
      )
@@ -90,6 +90,11 @@ namespace graphene { namespace app {
 
          net::node_ptr                    p2p_node();
          std::shared_ptr<chain::database> chain_database()const;
+         /// The node's data directory, as passed to initialize()
+         fc::path data_dir()const;
+
+         /// Screens and pushes a transaction received from the network or the API, see transaction_admission
+         void admit_transaction( const chain::precomputable_transaction& trx );
 
          void set_block_production(bool producing_blocks);
          fc::optional< api_access_info > get_api_access_info( const string& username )const;
@@ -394,6 +394,14 @@ class database_api
        */
       vector<account_id_type> get_account_references( const std::string account_id_or_name )const;
 
+      /**
+       *  @brief Get the position of an account in the referral tree and the aggregates over its downline
+       *  @param account_id_or_name ID or name of the account
+       *  @return depth, referrer, direct referral count, downline size and stored personal volumes,
+       *          or null if the account is not part of the tree
+       */
+      optional<referral_tree_node> get_referral_tree_node( const std::string account_id_or_name )const;
+
       /**
        * @brief Get a list of accounts by name
        * @param account_names Names of the accounts to retrieve
@@ -837,6 +845,13 @@ class database_api
       // GREAT RACE //
       ////////////////
       vector<gr_rating_obj> gr_get_rating(const std::string rating_type) const; // rating_type in ['race', 'stage', 'current_interval', 'prev_interval']
+      /**
+       * @brief Get the place of a team in a Great Race rating, without listing the teams ahead of it
+       * @param rating_type one of 'race', 'stage', 'current_interval' or 'prev_interval', as for gr_get_rating
+       * @param team_id the team to look up
+       * @return the place of the team, 1 for the highest volume
+       */
+      uint64_t gr_get_team_place(const std::string rating_type, const gr_team_id_type team_id) const;
       vector<gr_invite_obj> gr_get_invites(const std::string account_id_or_name) const;
       vector<gr_range_bet_api_obj> gr_get_range_bets() const;
       vector<gr_team_bet_api_obj> gr_get_team_bets() const;
@@ -897,6 +912,7 @@ FC_API(graphene::app::database_api,
    (get_full_accounts)
    (get_account_by_name)
    (get_account_references)
+   (get_referral_tree_node)
    (lookup_account_names)
    (lookup_accounts)
    (get_account_count)
@@ -998,6 +1014,7 @@ FC_API(graphene::app::database_api,
 
    // Great Race
    (gr_get_rating)
+   (gr_get_team_place)
    (gr_get_invites)
    (gr_get_range_bets)
    (gr_get_team_bets)
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2018 Abit More, and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/database.hpp>
+
+#include <fc/thread/future.hpp>
+
+#include <deque>
+
+namespace graphene { namespace app {
+   using namespace graphene::chain;
+
+   /**
+    * Admits transactions received from the p2p network and the API in batches.
+    *
+    * Transactions that arrive while a batch is being screened form the next batch. A batch is precomputed on the
+    * worker pool by database::screen_transactions(), which recovers the signature keys of all of its transactions
+    * at once. The transactions that pass are pushed one by one, in arrival order, on the chain thread, where
+    * push_transaction() checks them against the state.
+    */
+   class transaction_admission
+   {
+      public:
+         transaction_admission( database& db, uint32_t max_batch_size );
+         ~transaction_admission();
+
+         /**
+          * Queues a copy of @p trx for screening and waits until it has been pushed. Call on the chain thread only.
+          * Throws the exception that screening or database::push_transaction() raised for the transaction.
+          */
+         void push( const precomputable_transaction& trx );
+
+      private:
+         struct pending_transaction
+         {
+            std::shared_ptr<const precomputable_transaction> trx;
+            fc::promise<void>::ptr                           done;
+         };
+
+         void process_batches();
+         /// @return a copy of the exception being handled, to fail a promise with
+         static fc::exception_ptr current_exception();
+
+         database&                        _db;
+         const uint32_t                   _max_batch_size;
+         std::deque<pending_transaction>  _queue;
+         fc::future<void>                 _processing;
+   };
+
+} }
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018 Abit More, and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/app/transaction_admission.hpp>
+
+#include <fc/thread/thread.hpp>
+
+namespace graphene { namespace app {
+
+transaction_admission::transaction_admission( database& db, uint32_t max_batch_size )
+   : _db( db ), _max_batch_size( std::max<uint32_t>( 1, max_batch_size ) )
+{
+}
+
+transaction_admission::~transaction_admission()
+{
+   try
+   {
+      if( _processing.valid() && !_processing.ready() )
+         _processing.cancel_and_wait( "transaction_admission destroyed" );
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "Exception while stopping transaction admission: ${e}", ("e", e.to_detail_string()) );
+   }
+
+   // nothing will process the transactions that are still queued, release their submitters
+   for( const pending_transaction& p : _queue )
+      p.done->set_exception( std::make_shared<fc::canceled_exception>(
+                                FC_LOG_MESSAGE( warn, "transaction_admission destroyed" ) ) );
+   _queue.clear();
+}
+
+fc::exception_ptr transaction_admission::current_exception()
+{
+   fc::exception_ptr error;
+   try
+   {
+      throw;
+   }
+   catch( const fc::exception& e )
+   {
+      error = e.dynamic_copy_exception();
+   }
+   catch( const std::exception& e )
+   {
+      error = std::make_shared<fc::unhandled_exception>( FC_LOG_MESSAGE( warn, "${what}", ("what",e.what()) ),
+                                                         std::current_exception() );
+   }
+   catch( ... )
+   {
+      error = std::make_shared<fc::unhandled_exception>( FC_LOG_MESSAGE( warn, "unknown exception" ),
+                                                         std::current_exception() );
+   }
+   return error;
+}
+
+void transaction_admission::push( const precomputable_transaction& trx )
+{
+   fc::promise<void>::ptr done( new fc::promise<void>( "transaction_admission::push" ) );
+   // the caller may stop waiting, e.g. when its fiber is canceled, so the queue keeps its own copy
+   _queue.push_back( { std::make_shared<const precomputable_transaction>( trx ), done } );
+   if( !_processing.valid() || _processing.ready() )
+      _processing = fc::async( [this]() { process_batches(); }, "transaction_admission" );
+   fc::future<void>( done ).wait();
+}
+
+void transaction_admission::process_batches()
+{
+   while( !_queue.empty() )
+   {
+      const size_t count = std::min<size_t>( _queue.size(), _max_batch_size );
+      vector<pending_transaction> batch( _queue.begin(), _queue.begin() + count );
+      _queue.erase( _queue.begin(), _queue.begin() + count );
+
+      vector<const precomputable_transaction*> trxs;
+      trxs.reserve( batch.size() );
+      for( const pending_transaction& p : batch )
+         trxs.push_back( p.trx.get() );
+
+      // this fiber yields while the batch is screened, transactions arriving meanwhile make up the next one
+      vector<fc::exception_ptr> rejected;
+      try
+      {
+         rejected = _db.screen_transactions( trxs );
+      }
+      catch( ... )
+      {
+         const fc::exception_ptr error = current_exception();
+         for( const pending_transaction& p : batch )
+            p.done->set_exception( error );
+         // a canceled fiber must stop, the destructor fails what is still queued
+         if( error->code() == fc::canceled_exception_code )
+            throw;
+         continue;
+      }
+
+      for( size_t i = 0; i < batch.size(); ++i )
+      {
+         if( rejected[i] )
+         {
+            batch[i].done->set_exception( rejected[i] );
+            continue;
+         }
+         try
+         {
+            _db.push_transaction( *batch[i].trx );
+            batch[i].done->set_value();
+         }
+         catch( ... )
+         {
+            batch[i].done->set_exception( current_exception() );
+         }
+      }
+   }
+}
+
+} } // graphene::app
@@ -24,6 +24,7 @@
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/greatrace_object.hpp>
+#include <graphene/chain/referral_path.hpp>
 
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/hardfork.hpp>
@@ -47,48 +48,6 @@ share_type cut_fee(share_type a, uint16_t p)
    return r.to_uint64();
 }
 
-account_id_type next_rewardable(const account_object &a, database &d) 
-{
-   reward_log( "Called next_rewardable with account ${acc}", ("acc",a.name));
-   const auto &params = d.get_global_properties().parameters;
-   if (a.get_id() < params.root_account || a.get_id() == params.root_account) 
-   {
-      reward_log( "next_rewardable Return Root");
-      return params.root_account;
-   }
-   else {
-      if (params.compression)
-      {
-         account_object ref = d.get(a.get_id());
-         uint8_t current_compression = 0;
-         do
-         {
-            ref = d.get(ref.referrer);
-            current_compression++;
-         reward_log( "next_rewardable:do_while account ${acc}, compression level ${level}, PV ${pv}, PVCL ${pvcl}", ("acc",ref.name)("level",current_compression)("pv",ref.statistics(d).get_pv(d))("pvcl",params.compression_limit));
-         } while (
-            ((ref.active_referral_status(d.head_block_time()) == 0) && ( current_compression <= params.compression_levels ) && ( ref.get_id() > params.root_account ) )||
-            ((( current_compression <= params.compression_levels ) && ( ref.get_id() > params.root_account )) &&
-            (( ref.statistics(d).get_pv(d) <= params.compression_limit && ref.active_referral_status(d.head_block_time())) &&
-              (ref.active_referral_status(d.head_block_time()) < params.min_not_compressed )))
-         );
-         reward_log( "next_rewardable Return ${acc}", ("acc",ref.name));
-         if (ref.get_id() < params.root_account) 
-         {
-            return params.root_account;
-         }
-         else {
-            return ref.get_id();
-         }
-      }
-      else
-      {
-         reward_log( "next_rewardable Return WO Compression ${acc}", ("acc",a.referrer));
-         return a.referrer;
-      }
-   }
-}
-
 share_type account_statistics_object::get_pv(database &d) const
    {
       const auto &params = d.get_global_properties().parameters;
@@ -139,7 +98,7 @@ share_type account_statistics_object::get_nv(database &d) const
    }
 
 // leader bonus process
-void account_statistics_object::update_nv(share_type volume, uint8_t level, uint16_t max_reward_level, const account_object &a, database &d, std::set<account_id_type> accounts_set) const
+void account_statistics_object::update_nv(share_type volume, uint8_t level, uint16_t max_reward_level, const account_object &a, database &d, std::set<account_id_type> &accounts_set) const
 {
    reward_log( "Called update_nv for account =${acc}= and volume ${vol}, current level ${level}!", ("acc",a.name)("vol",volume)("level",level));
    const auto &params = d.get_global_properties().parameters;
@@ -265,17 +224,10 @@ void account_statistics_object::process_fees(const account_object &a, database &
          const auto &params = d.get_global_properties().parameters;
          share_type network_cut = core_fee_total;
          share_type total_denominator_volume = 0;
-         account_object cbk_tmp;
          reward_log( "Called pay_out_fees with account =${acc}=", ("acc",account.name));
-         if (params.cashback && account.active_referral_status(d.head_block_time()) > 0)
-         {
-            cbk_tmp = account;
-         }
-         else
-         {
-            cbk_tmp = d.get(next_rewardable(account, d));
-         }
-         const account_object& ref_01 = cbk_tmp;
+         const account_object& ref_01 = (params.cashback && account.active_referral_status(d.head_block_time()) > 0)
+                                        ? account
+                                        : d.get(next_rewardable(account, d));
          reward_log( "pay_out_fees ref_01 =${acc}=", ("acc",ref_01.name));
 
          std::set<account_id_type> accounts_set = {};
@@ -963,15 +915,208 @@ void account_member_index::object_modified(const object &after)
 
 void account_referrer_index::object_inserted(const object &obj)
 {
+   assert(dynamic_cast<const account_object *>(&obj)); // for debug only
+   const account_object &a = static_cast<const account_object &>(obj);
+
+   if (a.referrer != a.get_id())
+      referred_by[a.referrer].insert(a.get_id());
+   get_or_create_node(a.get_id());
+   attach(a.get_id(), a.referrer);
 }
+
 void account_referrer_index::object_removed(const object &obj)
 {
+   assert(dynamic_cast<const account_object *>(&obj)); // for debug only
+   const account_object &a = static_cast<const account_object &>(obj);
+
+   auto itr = referred_by.find(a.referrer);
+   if (itr != referred_by.end())
+   {
+      itr->second.erase(a.get_id());
+      if (itr->second.empty())
+         referred_by.erase(itr);
+   }
+   if (find_node(a.get_id()) == nullptr)
+      return;
+   detach(a.get_id());
+   if (nodes[a.get_id().instance.value].downline_size == 0)
+      known[a.get_id().instance.value] = false;
 }
+
 void account_referrer_index::about_to_modify(const object &before)
 {
+   assert(dynamic_cast<const account_object *>(&before)); // for debug only
+   referrers_being_modified.push(static_cast<const account_object &>(before).referrer);
 }
+
 void account_referrer_index::object_modified(const object &after)
 {
+   assert(dynamic_cast<const account_object *>(&after)); // for debug only
+   const account_object &a = static_cast<const account_object &>(after);
+
+   const account_id_type old_referrer = referrers_being_modified.top();
+   referrers_being_modified.pop();
+   if (old_referrer == a.referrer)
+      return;
+
+   auto itr = referred_by.find(old_referrer);
+   if (itr != referred_by.end())
+   {
+      itr->second.erase(a.get_id());
+      if (itr->second.empty())
+         referred_by.erase(itr);
+   }
+   if (a.referrer != a.get_id())
+      referred_by[a.referrer].insert(a.get_id());
+
+   get_or_create_node(a.get_id());
+   detach(a.get_id());
+   attach(a.get_id(), a.referrer);
+   update_depths(a.get_id());
+}
+
+const referral_tree_node *account_referrer_index::find_node(account_id_type acct) const
+{
+   const uint64_t instance = acct.instance.value;
+   if (instance >= known.size() || !known[instance])
+      return nullptr;
+   return &nodes[instance];
+}
+
+void account_referrer_index::set_personal_volume(account_id_type acct, share_type volume)
+{
+   referral_tree_node &node = get_or_create_node(acct);
+   const share_type delta = volume - node.personal_volume;
+   if (delta == 0)
+      return;
+   node.personal_volume = volume;
+
+   account_id_type current = acct;
+   while (!is_root(current))
+   {
+      current = nodes[current.instance.value].referrer;
+      nodes[current.instance.value].downline_volume += delta;
+   }
+}
+
+referral_tree_node &account_referrer_index::get_or_create_node(account_id_type acct)
+{
+   const uint64_t instance = acct.instance.value;
+   if (instance >= nodes.size())
+   {
+      nodes.resize(instance + 1);
+      known.resize(instance + 1, false);
+   }
+   if (!known[instance])
+   {
+      nodes[instance] = referral_tree_node();
+      nodes[instance].referrer = acct;
+      known[instance] = true;
+   }
+   return nodes[instance];
+}
+
+bool account_referrer_index::is_root(account_id_type acct) const
+{
+   return nodes[acct.instance.value].referrer == acct;
+}
+
+void account_referrer_index::attach(account_id_type acct, account_id_type referrer)
+{
+   if (referrer == acct)
+      return;
+   get_or_create_node(referrer);
+
+   // Historic referrer changes may have closed a loop, such an account is kept as a root of its own
+   for (account_id_type current = referrer; ; current = nodes[current.instance.value].referrer)
+   {
+      if (current == acct)
+         return;
+      if (is_root(current))
+         break;
+   }
+
+   referral_tree_node &node = nodes[acct.instance.value];
+   referral_tree_node &parent = nodes[referrer.instance.value];
+   node.referrer = referrer;
+   node.depth = parent.depth + 1;
+   parent.direct_referrals++;
+
+   const uint64_t size = node.downline_size + 1;
+   const share_type volume = node.downline_volume + node.personal_volume;
+   account_id_type current = acct;
+   while (!is_root(current))
+   {
+      current = nodes[current.instance.value].referrer;
+      nodes[current.instance.value].downline_size += size;
+      nodes[current.instance.value].downline_volume += volume;
+   }
+}
+
+void account_referrer_index::detach(account_id_type acct)
+{
+   if (is_root(acct))
+      return;
+   referral_tree_node &node = nodes[acct.instance.value];
+   nodes[node.referrer.instance.value].direct_referrals--;
+
+   const uint64_t size = node.downline_size + 1;
+   const share_type volume = node.downline_volume + node.personal_volume;
+   account_id_type current = acct;
+   while (!is_root(current))
+   {
+      current = nodes[current.instance.value].referrer;
+      nodes[current.instance.value].downline_size -= size;
+      nodes[current.instance.value].downline_volume -= volume;
+   }
+   node.referrer = acct;
+   node.depth = 0;
+}
+
+void account_referrer_index::update_depths(account_id_type acct)
+{
+   std::deque<account_id_type> pending(1, acct);
+   while (!pending.empty())
+   {
+      const account_id_type current = pending.front();
+      pending.pop_front();
+      const uint32_t child_depth = nodes[current.instance.value].depth + 1;
+
+      auto itr = referred_by.find(current);
+      if (itr == referred_by.end())
+         continue;
+      for (const account_id_type &child : itr->second)
+      {
+         const referral_tree_node *child_node = find_node(child);
+         // only follow the edges that are part of the tree, see attach()
+         if (child_node == nullptr || child_node->referrer != current)
+            continue;
+         nodes[child.instance.value].depth = child_depth;
+         pending.push_back(child);
+      }
+   }
+}
+
+void referral_volume_index::object_inserted(const object &obj)
+{
+   assert(dynamic_cast<const account_statistics_object *>(&obj)); // for debug only
+   const account_statistics_object &s = static_cast<const account_statistics_object &>(obj);
+   tree->set_personal_volume(s.owner, s.personal_volume_in_period);
+}
+
+void referral_volume_index::object_removed(const object &obj)
+{
+   assert(dynamic_cast<const account_statistics_object *>(&obj)); // for debug only
+   const account_statistics_object &s = static_cast<const account_statistics_object &>(obj);
+   if (tree->find_node(s.owner) != nullptr)
+      tree->set_personal_volume(s.owner, 0);
+}
+
+void referral_volume_index::object_modified(const object &after)
+{
+   assert(dynamic_cast<const account_statistics_object *>(&after)); // for debug only
+   const account_statistics_object &s = static_cast<const account_statistics_object &>(after);
+   tree->set_personal_volume(s.owner, s.personal_volume_in_period);
 }
 
 const uint8_t balances_by_account_index::bits = 20;
@@ -1028,5 +1173,44 @@ const account_balance_object *balances_by_account_index::get_account_balance(con
    return itr->second;
 }
 
+void holders_by_asset_index::object_inserted(const object &obj)
+{
+   const auto &abo = dynamic_cast<const account_balance_object &>(obj);
+   if (counts.size() <= abo.asset_type.instance.value)
+      counts.resize(abo.asset_type.instance.value + 1);
+   ++counts[abo.asset_type.instance.value];
+}
+
+void holders_by_asset_index::object_removed(const object &obj)
+{
+   const auto &abo = dynamic_cast<const account_balance_object &>(obj);
+   if (counts.size() > abo.asset_type.instance.value && counts[abo.asset_type.instance.value] > 0)
+      --counts[abo.asset_type.instance.value];
+}
+
+void holders_by_asset_index::about_to_modify(const object &before)
+{
+   assets_being_modified.emplace(dynamic_cast<const account_balance_object &>(before).asset_type);
+}
+
+void holders_by_asset_index::object_modified(const object &after)
+{
+   const auto &abo = dynamic_cast<const account_balance_object &>(after);
+   const asset_id_type before = assets_being_modified.top();
+   assets_being_modified.pop();
+   if (before == abo.asset_type)
+      return;
+   if (counts.size() > before.instance.value && counts[before.instance.value] > 0)
+      --counts[before.instance.value];
+   object_inserted(after);
+}
+
+uint64_t holders_by_asset_index::get_balance_count(const asset_id_type &asset) const
+{
+   if (counts.size() <= asset.instance.value)
+      return 0;
+   return counts[asset.instance.value];
+}
+
 } // namespace chain
 } // namespace graphene
@@ -45,32 +45,57 @@ void block_database::open( const fc::path& dbdir )
    _blocks.exceptions(std::ios_base::failbit | std::ios_base::badbit);
 
    _index_filename = dbdir / "index";
+   reset_mappings();
+   _mapped_index.path = _index_filename;
+   _mapped_blocks.path = dbdir / "blocks";
    if( !fc::exists( _index_filename ) )
    {
+     _compressed = _compress_new_logs;
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+     if( _compressed )
+        fc::remove( dbdir/"blocks" );
+     else
+        _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+     compressed_block_log::remove( dbdir );
    }
    else
    {
+     _compressed = compressed_block_log::exists( dbdir );
+     if( _compressed != _compress_new_logs )
+        wlog( "Keeping the ${format} format of the existing block database in ${dir}, resync to convert it",
+              ("format", _compressed ? "compressed" : "uncompressed")("dir", dbdir) );
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+     if( !_compressed )
+        _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+   }
+   if( _compressed )
+   {
+     _compressed_blocks.open( dbdir );
+     _compressed_read_pos = 0;
    }
 } FC_CAPTURE_AND_RETHROW( (dbdir) ) }
 
 bool block_database::is_open()const
 {
-  return _blocks.is_open();
+  return _compressed ? _compressed_blocks.is_open() : _blocks.is_open();
 }
 
 void block_database::close()
 {
-  _blocks.close();
+  reset_mappings();
+  if( _compressed )
+    _compressed_blocks.close();
+  else
+    _blocks.close();
   _block_num_to_pos.close();
 }
 
 void block_database::flush()
 {
-  _blocks.flush();
+  if( _compressed )
+    _compressed_blocks.flush();
+  else
+    _blocks.flush();
   _block_num_to_pos.flush();
 }
 
@@ -84,13 +109,23 @@ void block_database::store( const block_id_type& _id, const signed_block& b )
    }
    _block_num_to_pos.seekp( sizeof( index_entry ) * int64_t(block_header::num_from_id(id)) );
    index_entry e;
-   _blocks.seekp( 0, _blocks.end );
    auto vec = fc::raw::pack( b );
-   e.block_pos  = _blocks.tellp();
+   if( _compressed )
+      e.block_pos = _compressed_blocks.append( vec );
+   else
+   {
+      _blocks.seekp( 0, _blocks.end );
+      e.block_pos  = _blocks.tellp();
+      _blocks.write( vec.data(), vec.size() );
+   }
    e.block_size = vec.size();
    e.block_id   = id;
-   _blocks.write( vec.data(), vec.size() );
    _block_num_to_pos.write( (char*)&e, sizeof(e) );
+   if( _mapped_reads )
+   {
+      // the block has to be in the file before its index entry becomes visible through the mapping
+      flush();
+   }
 }
 
 void block_database::remove( const block_id_type& id )
@@ -109,6 +144,8 @@ void block_database::remove( const block_id_type& id )
       e.block_size = 0;
       _block_num_to_pos.seekp( sizeof(e) * int64_t(block_header::num_from_id(id)) );
       _block_num_to_pos.write( (char*)&e, sizeof(e) );
+      if( _mapped_reads )
+         _block_num_to_pos.flush();
    }
 } FC_CAPTURE_AND_RETHROW( (id) ) }
 
@@ -118,6 +155,9 @@ bool block_database::contains( const block_id_type& id )const
       return false;
 
    index_entry e;
+   if( _mapped_reads )
+      return read_mapped_index_entry( block_header::num_from_id(id), e ) && e.block_id == id && e.block_size > 0;
+
    int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
    _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
    if ( _block_num_to_pos.tellg() < int64_t(index_pos + sizeof(e)) )
@@ -132,6 +172,14 @@ block_id_type block_database::fetch_block_id( uint32_t block_num )const
 {
    assert( block_num != 0 );
    index_entry e;
+   if( _mapped_reads )
+   {
+      if( !read_mapped_index_entry( block_num, e ) )
+         FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block number ${block_num} not contained in block database", ("block_num", block_num));
+      FC_ASSERT( e.block_id != block_id_type(), "Empty block_id in block_database (maybe corrupt on disk?)" );
+      return e.block_id;
+   }
+
    int64_t index_pos = sizeof(e) * int64_t(block_num);
    _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
    if ( _block_num_to_pos.tellg() <= index_pos )
@@ -149,6 +197,13 @@ optional<signed_block> block_database::fetch_optional( const block_id_type& id )
    try
    {
       index_entry e;
+      if( _mapped_reads )
+      {
+         if( !read_mapped_index_entry( block_header::num_from_id(id), e ) || e.block_id != id )
+            return optional<signed_block>();
+         return read_mapped_block( e );
+      }
+
       int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
       _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
       if ( _block_num_to_pos.tellg() <= index_pos )
@@ -159,10 +214,9 @@ optional<signed_block> block_database::fetch_optional( const block_id_type& id )
 
       if( e.block_id != id ) return optional<signed_block>();
 
-      vector<char> data( e.block_size );
-      _blocks.seekg( e.block_pos );
-      if (e.block_size)
-         _blocks.read( data.data(), e.block_size );
+      vector<char> data;
+      if( !read_block_data( e, data ) )
+         return optional<signed_block>();
       auto result = fc::raw::unpack<signed_block>(data);
       FC_ASSERT( result.id() == e.block_id );
       return result;
@@ -181,6 +235,13 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
    try
    {
       index_entry e;
+      if( _mapped_reads )
+      {
+         if( !read_mapped_index_entry( block_num, e ) )
+            return optional<signed_block>();
+         return read_mapped_block( e );
+      }
+
       int64_t index_pos = sizeof(e) * int64_t(block_num);
       _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
       if ( _block_num_to_pos.tellg() <= index_pos )
@@ -189,9 +250,9 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
       _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
       _block_num_to_pos.read( (char*)&e, sizeof(e) );
 
-      vector<char> data( e.block_size );
-      _blocks.seekg( e.block_pos );
-      _blocks.read( data.data(), e.block_size );
+      vector<char> data;
+      if( !read_block_data( e, data ) )
+         return optional<signed_block>();
       auto result = fc::raw::unpack<signed_block>(data);
       FC_ASSERT( result.id() == e.block_id );
       return result;
@@ -217,8 +278,7 @@ optional<index_entry> block_database::last_index_entry()const {
 
       pos -= pos % sizeof(index_entry);
 
-      _blocks.seekg( 0, _block_num_to_pos.end );
-      const std::streampos blocks_size = _blocks.tellg();
+      const int64_t blocks_size = total_block_size();
       while( pos > 0 )
       {
          pos -= sizeof(index_entry);
@@ -228,10 +288,8 @@ optional<index_entry> block_database::last_index_entry()const {
                 && int64_t(e.block_pos + e.block_size) <= blocks_size )
             try
             {
-               vector<char> data( e.block_size );
-               _blocks.seekg( e.block_pos );
-               _blocks.read( data.data(), e.block_size );
-               if( _blocks.gcount() == long(e.block_size) )
+               vector<char> data;
+               if( read_block_data( e, data ) )
                {
                   const signed_block block = fc::raw::unpack<signed_block>(data);
                   if( block.id() == e.block_id )
@@ -244,6 +302,8 @@ optional<index_entry> block_database::last_index_entry()const {
             catch (const std::exception&)
             {
             }
+         // the index must not shrink below an existing mapping of it
+         reset_mappings();
          fc::resize_file( _index_filename, pos );
       }
    }
@@ -270,15 +330,125 @@ optional<block_id_type> block_database::last_id()const
    return optional<block_id_type>();
 }
 
+bool block_database::read_block_data( const index_entry& e, vector<char>& data )const
+{
+   if( _compressed )
+   {
+      if( !_compressed_blocks.read( e.block_pos, e.block_size, data ) )
+         return false;
+      _compressed_read_pos = e.block_pos + e.block_size;
+      return true;
+   }
+
+   data.resize( e.block_size );
+   if( e.block_size == 0 )
+      return true;
+   _blocks.seekg( e.block_pos );
+   _blocks.read( data.data(), e.block_size );
+   return _blocks.gcount() == long(e.block_size);
+}
+
 size_t block_database::blocks_current_position()const
 {
+   if( _compressed )
+      return (size_t)_compressed_read_pos;
    return (size_t)_blocks.tellg();
 }
 
 size_t block_database::total_block_size()const
 {
+   if( _compressed )
+      return (size_t)_compressed_blocks.size();
    _blocks.seekg( 0, _blocks.end );
    return (size_t)_blocks.tellg();
 }
 
+void block_database::enable_compression( bool enable, uint32_t frame_size, uint32_t cached_frames )
+{
+   _compress_new_logs = enable;
+   _compressed_blocks.set_frame_size( frame_size );
+   _compressed_blocks.set_cache_size( cached_frames );
+}
+
+void block_database::enable_mapped_reads( bool enable )
+{
+   if( enable == _mapped_reads )
+      return;
+   if( enable && is_open() )
+      flush();
+   else if( !enable )
+      reset_mappings();
+   _mapped_reads = enable;
+}
+
+template<typename Reader>
+bool block_database::read_mapped( mapped_file& mf, uint64_t pos, uint64_t size, Reader&& reader )const
+{
+   {
+      boost::shared_lock<boost::shared_mutex> lock( _mapping_mutex );
+      if( mf.region && pos + size <= mf.region->get_size() )
+      {
+         reader( (const char*)mf.region->get_address() + pos );
+         return true;
+      }
+   }
+
+   boost::unique_lock<boost::shared_mutex> lock( _mapping_mutex );
+   // another reader may have remapped the file in the meantime
+   if( !mf.region || pos + size > mf.region->get_size() )
+   {
+      const uint64_t file_size = fc::exists( mf.path ) ? fc::file_size( mf.path ) : 0;
+      if( pos + size > file_size )
+         return false;
+      mf.region.reset();
+      if( !mf.file )
+         mf.file.reset( new fc::file_mapping( mf.path.generic_string().c_str(), fc::read_only ) );
+      mf.region.reset( new fc::mapped_region( *mf.file, fc::read_only, 0, file_size ) );
+   }
+   reader( (const char*)mf.region->get_address() + pos );
+   return true;
+}
+
+bool block_database::read_mapped_index_entry( uint32_t block_num, index_entry& e )const
+{
+   return read_mapped( _mapped_index, sizeof(e) * uint64_t(block_num), sizeof(e), [&e]( const char* data ) {
+      memcpy( (char*)&e, data, sizeof(e) );
+   });
+}
+
+optional<signed_block> block_database::read_mapped_block( const index_entry& e )const
+{
+   if( e.block_size == 0 )
+      return optional<signed_block>();
+   optional<signed_block> result;
+   if( _compressed )
+   {
+      // only the index is mapped, the compressed log serves the block bytes from its frame cache
+      vector<char> data;
+      if( !read_block_data( e, data ) )
+         return optional<signed_block>();
+      result = fc::raw::unpack<signed_block>( data );
+      FC_ASSERT( result->id() == e.block_id );
+      return result;
+   }
+   if( !read_mapped( _mapped_blocks, e.block_pos, e.block_size, [&e,&result]( const char* data ) {
+         // unpack straight from the mapping, without copying the packed block first
+         fc::datastream<const char*> ds( data, e.block_size );
+         result = signed_block();
+         fc::raw::unpack( ds, *result );
+      }) )
+      return optional<signed_block>();
+   FC_ASSERT( result->id() == e.block_id );
+   return result;
+}
+
+void block_database::reset_mappings()const
+{
+   boost::unique_lock<boost::shared_mutex> lock( _mapping_mutex );
+   _mapped_index.region.reset();
+   _mapped_index.file.reset();
+   _mapped_blocks.region.reset();
+   _mapped_blocks.file.reset();
+}
+
 } }
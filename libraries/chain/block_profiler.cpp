@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/block_profiler.hpp>
+#include <graphene/chain/protocol/operations.hpp>
+
+#include <fc/log/logger.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace graphene { namespace chain {
+
+namespace {
+
+   const char* const block_stage_names[block_stage_count] = {
+      "apply_block",
+      "transactions",
+      "block_header_updates",
+      "perform_chain_maintenance",
+      "clear_expired_transactions",
+      "clear_expired_proposals",
+      "clear_expired_orders",
+      "proceed_bets",
+      "proceed_lottery_goods",
+      "proceed_matrix",
+      "auto_cancel_p2p_orders",
+      "auto_reset_status",
+      "proceed_pledge",
+      "proceed_approved_transfer",
+      "update_expired_feeds",
+      "update_core_exchange_rates",
+      "update_withdraw_permissions",
+      "update_witness_schedule",
+      "notify_applied_block",
+      "notify_changed_objects"
+   };
+
+   const char* const operation_phase_names[block_profiler::operation_phase_count] = {
+      "evaluate",
+      "apply",
+      "total"
+   };
+
+   int64_t steady_ns()
+   {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch() ).count();
+   }
+
+   size_t bucket_of( uint64_t ticks )
+   {
+      if( ticks < 4 )
+         return ticks;
+      const size_t exponent = 63 - __builtin_clzll( ticks );
+      const size_t bucket = 4 * ( exponent - 1 ) + ( ( ticks >> ( exponent - 2 ) ) & 3 );
+      return std::min( bucket, profile_stats::bucket_count - 1 );
+   }
+
+   uint64_t bucket_lower_bound( size_t bucket )
+   {
+      if( bucket < 4 )
+         return bucket;
+      const size_t exponent = bucket / 4 + 1;
+      return uint64_t( 4 + bucket % 4 ) << ( exponent - 2 );
+   }
+
+   struct operation_name_visitor
+   {
+      typedef std::string result_type;
+      template<typename Op>
+      std::string operator()( const Op& )const { return fc::get_typename<Op>::name(); }
+   };
+
+   std::string operation_name( int op_type )
+   {
+      operation op;
+      op.set_which( op_type );
+      std::string name = op.visit( operation_name_visitor() );
+      const auto pos = name.rfind( "::" );
+      return pos == std::string::npos ? name : name.substr( pos + 2 );
+   }
+
+} // anonymous namespace
+
+void profile_stats::record( uint64_t ticks, uint64_t touched_objects, uint64_t bytes )
+{
+   ++count;
+   total += ticks;
+   max = std::max( max, ticks );
+   objects += touched_objects;
+   undo_bytes += bytes;
+   ++buckets[bucket_of( ticks )];
+}
+
+void profile_stats::merge( const profile_stats& other )
+{
+   count += other.count;
+   total += other.total;
+   max = std::max( max, other.max );
+   objects += other.objects;
+   undo_bytes += other.undo_bytes;
+   for( size_t i = 0; i < bucket_count; ++i )
+      buckets[i] += other.buckets[i];
+}
+
+uint64_t profile_stats::percentile( double fraction )const
+{
+   if( count == 0 )
+      return 0;
+   const uint64_t rank = std::max<uint64_t>( 1, uint64_t( fraction * count + 0.5 ) );
+   uint64_t seen = 0;
+   for( size_t i = 0; i < bucket_count; ++i )
+   {
+      seen += buckets[i];
+      if( seen >= rank )
+         return std::min( bucket_lower_bound( i ), max );
+   }
+   return max;
+}
+
+void block_profiler::stats_set::clear()
+{
+   stages.fill( profile_stats() );
+   for( auto& stats : operations )
+      stats = profile_stats();
+}
+
+void block_profiler::enable( bool enable, uint32_t log_interval )
+{
+   _enabled = enable;
+   _log_interval = log_interval;
+   if( !enable )
+      return;
+   _start_ticks = ticks();
+   _start_ns = steady_ns();
+   const size_t slots = operation::count() * operation_phase_count;
+   _operations.assign( slots, profile_stats() );
+   _touched_operations.assign( slots, false );
+   _interval.operations.assign( slots, profile_stats() );
+   std::lock_guard<std::mutex> lock( _totals_mutex );
+   _totals.operations.assign( slots, profile_stats() );
+}
+
+uint64_t block_profiler::ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+   return __rdtsc();
+#else
+   return steady_ns();
+#endif
+}
+
+void block_profiler::record_operation( int op_type, operation_phase phase, uint64_t start_ticks,
+                                       uint64_t touched_objects, uint64_t bytes )
+{
+   const size_t slot = size_t( op_type ) * operation_phase_count + phase;
+   if( slot >= _operations.size() )
+      return;
+   _operations[slot].record( ticks() - start_ticks, touched_objects, bytes );
+   _touched_operations[slot] = true;
+}
+
+void block_profiler::end_block( uint32_t block_num )
+{
+   if( !_enabled )
+      return;
+
+   {
+      std::lock_guard<std::mutex> lock( _totals_mutex );
+      for( size_t i = 0; i < block_stage_count; ++i )
+      {
+         if( _stages[i].count == 0 )
+            continue;
+         _interval.stages[i].merge( _stages[i] );
+         _totals.stages[i].merge( _stages[i] );
+         _stages[i] = profile_stats();
+      }
+      for( size_t i = 0; i < _operations.size(); ++i )
+      {
+         if( !_touched_operations[i] )
+            continue;
+         _interval.operations[i].merge( _operations[i] );
+         _totals.operations[i].merge( _operations[i] );
+         _operations[i] = profile_stats();
+         _touched_operations[i] = false;
+      }
+   }
+
+   if( _log_interval > 0 && block_num % _log_interval == 0 )
+   {
+      log_interval( block_num );
+      _interval.clear();
+   }
+}
+
+double block_profiler::ns_per_tick()const
+{
+   const uint64_t elapsed_ticks = ticks() - _start_ticks;
+   const int64_t elapsed_ns = steady_ns() - _start_ns;
+   if( elapsed_ticks == 0 || elapsed_ns <= 0 )
+      return 1.0;
+   return double( elapsed_ns ) / double( elapsed_ticks );
+}
+
+profile_summary block_profiler::summarize( const std::string& name, const profile_stats& stats, double scale )const
+{
+   profile_summary result;
+   result.name = name;
+   result.count = stats.count;
+   result.total_ns = uint64_t( stats.total * scale );
+   result.p50_ns = uint64_t( stats.percentile( 0.5 ) * scale );
+   result.p99_ns = uint64_t( stats.percentile( 0.99 ) * scale );
+   result.max_ns = uint64_t( stats.max * scale );
+   result.objects_touched = stats.objects;
+   result.undo_bytes = stats.undo_bytes;
+   return result;
+}
+
+void block_profiler::log_interval( uint32_t block_num )
+{
+   const double scale = ns_per_tick();
+   const profile_stats& block = _interval.stages[stage_apply_block];
+   if( block.count == 0 )
+      return;
+
+   // name the stage and the operation type that took the most time in total
+   size_t slowest_stage = stage_transactions;
+   for( size_t i = stage_transactions; i < block_stage_count; ++i )
+      if( _interval.stages[i].total > _interval.stages[slowest_stage].total )
+         slowest_stage = i;
+   size_t slowest_op = phase_total;
+   for( size_t i = phase_total; i < _interval.operations.size(); i += operation_phase_count )
+      if( _interval.operations[i].total > _interval.operations[slowest_op].total )
+         slowest_op = i;
+
+   const profile_summary b = summarize( block_stage_names[stage_apply_block], block, scale );
+   const profile_summary s = summarize( block_stage_names[slowest_stage], _interval.stages[slowest_stage], scale );
+   ilog( "Profile of ${n} blocks up to #${num}: p50 ${p50}us, p99 ${p99}us, max ${max}us; "
+         "most time in ${stage} (${st}us), operations: ${op} (${ot}us in ${oc})",
+         ("n", b.count)("num", block_num)("p50", b.p50_ns / 1000)("p99", b.p99_ns / 1000)("max", b.max_ns / 1000)
+         ("stage", s.name)("st", s.total_ns / 1000)
+         ("op", _interval.operations.empty() ? std::string() : operation_name( slowest_op / operation_phase_count ))
+         ("ot", _interval.operations.empty() ? 0 : uint64_t( _interval.operations[slowest_op].total * scale / 1000 ))
+         ("oc", _interval.operations.empty() ? 0 : _interval.operations[slowest_op].count) );
+}
+
+std::vector<profile_summary> block_profiler::get_stage_profile()const
+{
+   const double scale = ns_per_tick();
+   std::vector<profile_summary> result;
+   std::lock_guard<std::mutex> lock( _totals_mutex );
+   for( size_t i = 0; i < block_stage_count; ++i )
+      result.push_back( summarize( block_stage_names[i], _totals.stages[i], scale ) );
+   return result;
+}
+
+std::vector<profile_summary> block_profiler::get_operation_profile()const
+{
+   const double scale = ns_per_tick();
+   std::vector<profile_summary> result;
+   std::lock_guard<std::mutex> lock( _totals_mutex );
+   for( size_t i = 0; i < _totals.operations.size(); ++i )
+   {
+      if( _totals.operations[i].count == 0 )
+         continue;
+      result.push_back( summarize( operation_name( i / operation_phase_count ) + "." +
+                                   operation_phase_names[i % operation_phase_count],
+                                   _totals.operations[i], scale ) );
+   }
+   return result;
+}
+
+void block_profiler::reset()
+{
+   std::lock_guard<std::mutex> lock( _totals_mutex );
+   _totals.clear();
+}
+
+} } // graphene::chain
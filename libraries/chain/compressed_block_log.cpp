@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/compressed_block_log.hpp>
+
+#include <fc/compress/zlib.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace graphene { namespace chain {
+
+static fc::path frame_filename( const fc::path& dir )       { return dir / "blocks.frames"; }
+static fc::path frame_index_filename( const fc::path& dir ) { return dir / "blocks.frame_index"; }
+static fc::path tail_filename( const fc::path& dir )        { return dir / "blocks.tail"; }
+
+static void open_file( std::fstream& file, const fc::path& filename )
+{
+   file.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   if( fc::exists( filename ) )
+      file.open( filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+   else
+      file.open( filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc );
+}
+
+bool compressed_block_log::exists( const fc::path& dir )
+{
+   return fc::exists( frame_filename( dir ) );
+}
+
+void compressed_block_log::remove( const fc::path& dir )
+{
+   fc::remove( frame_filename( dir ) );
+   fc::remove( frame_index_filename( dir ) );
+   fc::remove( tail_filename( dir ) );
+}
+
+void compressed_block_log::open( const fc::path& dir )
+{ try {
+   std::lock_guard<std::mutex> lock( _mutex );
+   fc::create_directories( dir );
+   _tail_filename = tail_filename( dir );
+   _frames.clear();
+   _tail.clear();
+   _cache.clear();
+   _cache_index.clear();
+
+   // keep the frames that were completely written, a crash may have left a partial one behind
+   uint64_t logical_end = 0;
+   uint64_t file_end = 0;
+   const uint64_t frame_file_size = fc::exists( frame_filename( dir ) ) ? fc::file_size( frame_filename( dir ) ) : 0;
+   if( fc::exists( frame_index_filename( dir ) ) )
+   {
+      std::ifstream index( frame_index_filename( dir ).generic_string().c_str(), std::ifstream::binary );
+      frame_entry f;
+      while( index.read( (char*)&f, sizeof(f) ) )
+      {
+         if( f.logical_pos != logical_end || f.file_pos != file_end || f.logical_size == 0
+               || f.file_pos + f.compressed_size > frame_file_size )
+            break;
+         _frames.push_back( f );
+         logical_end += f.logical_size;
+         file_end += f.compressed_size;
+      }
+      index.close();
+      if( fc::file_size( frame_index_filename( dir ) ) != _frames.size() * sizeof(frame_entry) )
+         fc::resize_file( frame_index_filename( dir ), _frames.size() * sizeof(frame_entry) );
+   }
+   if( frame_file_size != file_end )
+      fc::resize_file( frame_filename( dir ), file_end );
+
+   open_file( _frame_file, frame_filename( dir ) );
+   open_file( _frame_index_file, frame_index_filename( dir ) );
+   _tail_pos = logical_end;
+
+   // the tail starts where the last frame ends, unless a crash happened between sealing it and resetting the tail
+   uint64_t tail_pos = logical_end;
+   bool tail_complete = false;
+   if( fc::exists( _tail_filename ) )
+   {
+      std::ifstream tail( _tail_filename.generic_string().c_str(), std::ifstream::binary );
+      if( tail.read( (char*)&tail_pos, sizeof(tail_pos) ) )
+      {
+         _tail.assign( std::istreambuf_iterator<char>( tail ), std::istreambuf_iterator<char>() );
+         tail_complete = true;
+      }
+      else
+         tail_pos = logical_end;
+   }
+   FC_ASSERT( tail_pos <= logical_end, "Compressed block log is missing frames before position ${pos}", ("pos", tail_pos) );
+   if( !tail_complete || tail_pos < logical_end )
+   {
+      _tail.erase( 0, std::min<uint64_t>( logical_end - tail_pos, _tail.size() ) );
+      reset_tail_file();
+   }
+   else
+      open_file( _tail_file, _tail_filename );
+} FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+bool compressed_block_log::is_open()const
+{
+   return _tail_file.is_open();
+}
+
+void compressed_block_log::flush()
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   _frame_file.flush();
+   _frame_index_file.flush();
+   _tail_file.flush();
+}
+
+void compressed_block_log::close()
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   _frame_file.close();
+   _frame_index_file.close();
+   _tail_file.close();
+   _cache.clear();
+   _cache_index.clear();
+}
+
+uint64_t compressed_block_log::append( const std::vector<char>& data )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   const uint64_t pos = _tail_pos + _tail.size();
+   _tail.append( data.data(), data.size() );
+   _tail_file.seekp( 0, _tail_file.end );
+   _tail_file.write( data.data(), data.size() );
+   if( _tail.size() >= _frame_size )
+      seal_tail();
+   return pos;
+}
+
+bool compressed_block_log::read( uint64_t pos, uint32_t size, std::vector<char>& data )const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   if( pos >= _tail_pos )
+   {
+      const uint64_t offset = pos - _tail_pos;
+      if( offset + size > _tail.size() )
+         return false;
+      data.assign( _tail.begin() + offset, _tail.begin() + offset + size );
+      return true;
+   }
+
+   // the first frame starts at 0, so pos always falls behind the beginning of some frame
+   auto itr = std::upper_bound( _frames.begin(), _frames.end(), pos, []( uint64_t p, const frame_entry& f ) {
+      return p < f.logical_pos;
+   });
+   const size_t frame = std::distance( _frames.begin(), itr ) - 1;
+   const frame_entry& f = _frames[frame];
+   if( pos + size > f.logical_pos + f.logical_size )
+      return false;
+
+   const frame_data frame_bytes = load_frame( frame );
+   const char* begin = frame_bytes->data() + ( pos - f.logical_pos );
+   data.assign( begin, begin + size );
+   return true;
+}
+
+uint64_t compressed_block_log::size()const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   return _tail_pos + _tail.size();
+}
+
+void compressed_block_log::seal_tail()
+{
+   frame_entry f;
+   f.logical_pos = _tail_pos;
+   f.file_pos = _frames.empty() ? 0 : _frames.back().file_pos + _frames.back().compressed_size;
+   f.logical_size = _tail.size();
+   const std::string compressed = fc::zlib_compress( _tail );
+   f.compressed_size = compressed.size();
+
+   // the frame has to be on disk before the tail that it replaces is dropped
+   _frame_file.seekp( f.file_pos );
+   _frame_file.write( compressed.data(), compressed.size() );
+   _frame_file.flush();
+   _frame_index_file.seekp( sizeof(f) * _frames.size() );
+   _frame_index_file.write( (const char*)&f, sizeof(f) );
+   _frame_index_file.flush();
+
+   _frames.push_back( f );
+   cache_frame( _frames.size() - 1, std::make_shared<const std::string>( std::move( _tail ) ) );
+   _tail_pos += f.logical_size;
+   _tail.clear();
+   reset_tail_file();
+}
+
+void compressed_block_log::reset_tail_file()
+{
+   if( _tail_file.is_open() )
+      _tail_file.close();
+   _tail_file.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   _tail_file.open( _tail_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc );
+   _tail_file.write( (const char*)&_tail_pos, sizeof(_tail_pos) );
+   _tail_file.write( _tail.data(), _tail.size() );
+   _tail_file.flush();
+}
+
+compressed_block_log::frame_data compressed_block_log::load_frame( size_t frame )const
+{
+   auto itr = _cache_index.find( frame );
+   if( itr != _cache_index.end() )
+   {
+      _cache.splice( _cache.begin(), _cache, itr->second );
+      return itr->second->second;
+   }
+
+   const frame_entry& f = _frames[frame];
+   std::string compressed( f.compressed_size, '\0' );
+   _frame_file.seekg( f.file_pos );
+   _frame_file.read( &compressed[0], f.compressed_size );
+   const frame_data result = std::make_shared<const std::string>( fc::zlib_decompress( compressed ) );
+   FC_ASSERT( result->size() == f.logical_size, "Corrupt frame ${frame} in compressed block log", ("frame", frame) );
+   cache_frame( frame, result );
+   return result;
+}
+
+void compressed_block_log::cache_frame( size_t frame, const frame_data& data )const
+{
+   _cache.emplace_front( frame, data );
+   _cache_index[frame] = _cache.begin();
+   while( _cache.size() > std::max<uint32_t>( _cache_size, 1 ) )
+   {
+      _cache_index.erase( _cache.back().first );
+      _cache.pop_back();
+   }
+}
+
+} }
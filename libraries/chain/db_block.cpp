@@ -113,6 +113,7 @@ std::vector<block_id_type> database::get_block_ids_on_fork(block_id_type head_of
 bool database::push_block(const signed_block& new_block, uint32_t skip)
 {
 //   idump((new_block.block_num())(new_block.id())(new_block.timestamp)(new_block.previous));
+   detail::state_write_guard write_guard( _state_gate );
    bool result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -225,6 +226,7 @@ processed_transaction database::push_transaction( const precomputable_transactio
 { try {
    // see https://github.com/bitshares/bitshares-core/issues/1573
    FC_ASSERT( fc::raw::pack_size( trx ) < (1024 * 1024), "Transaction exceeds maximum transaction size." );
+   detail::state_write_guard write_guard( _state_gate );
    processed_transaction result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -260,6 +262,7 @@ processed_transaction database::_push_transaction( const precomputable_transacti
 
 processed_transaction database::validate_transaction( const signed_transaction& trx )
 {
+   detail::state_write_guard write_guard( _state_gate );
    auto session = _undo_db.start_undo_session();
    return _apply_transaction( trx );
 }
@@ -329,6 +332,7 @@ signed_block database::generate_block(
    uint32_t skip /* = 0 */
    )
 { try {
+   detail::state_write_guard write_guard( _state_gate );
    signed_block result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -460,6 +464,7 @@ signed_block database::_generate_block(
  */
 void database::pop_block()
 { try {
+   detail::state_write_guard write_guard( _state_gate );
    _pending_tx_session.reset();
    auto fork_db_head = _fork_db.head();
    FC_ASSERT( fork_db_head, "Trying to pop() from empty fork database!?" );
@@ -474,8 +479,55 @@ void database::pop_block()
    _popped_tx.insert( _popped_tx.begin(), fork_db_head->data.transactions.begin(), fork_db_head->data.transactions.end() );
 } FC_CAPTURE_AND_RETHROW() }
 
+void database::with_irreversible_state( const std::function<void()>& f )
+{ try {
+   detail::state_write_guard write_guard( _state_gate );
+   detail::without_pending_transactions( *this, std::move(_pending_tx),
+   [&]()
+   {
+      const uint32_t last_irreversible_block_num = get_dynamic_global_properties().last_irreversible_block_num;
+      FC_ASSERT( _undo_db.size() >= head_block_num() - last_irreversible_block_num,
+                 "Not enough undo history to return to the last irreversible block ${n}",
+                 ("n",last_irreversible_block_num)("undo_states",_undo_db.size())("head",head_block_num()) );
+
+      const auto fork_head = _fork_db.head();
+      vector<signed_block> popped;
+      while( head_block_num() > last_irreversible_block_num )
+      {
+         auto block = fetch_block_by_id( head_block_id() );
+         FC_ASSERT( block.valid(), "Block ${id} is not in the fork database", ("id",head_block_id()) );
+         popped.push_back( std::move( *block ) );
+         pop_block();
+      }
+
+      std::exception_ptr error;
+      try
+      {
+         f();
+      }
+      catch( ... )
+      {
+         error = std::current_exception();
+      }
+
+      // the popped blocks were applied before, so they are applied again like the blocks of a fork we switch to
+      const uint32_t skip = get_node_properties().skip_flags;
+      for( auto itr = popped.rbegin(); itr != popped.rend(); ++itr )
+      {
+         auto session = _undo_db.start_undo_session();
+         apply_block( *itr, skip );
+         session.commit();
+      }
+      _fork_db.set_head( fork_head );
+
+      if( error )
+         std::rethrow_exception( error );
+   });
+} FC_CAPTURE_AND_RETHROW() }
+
 void database::clear_pending()
 { try {
+   detail::state_write_guard write_guard( _state_gate );
    assert( (_pending_tx.size() == 0) || _pending_tx_session.valid() );
    _pending_tx.clear();
    _pending_tx_session.reset();
@@ -524,8 +576,9 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
 
    detail::with_skip_flags( *this, skip, [&]()
    {
-      _apply_block( next_block );
+      _profiler.measure( stage_apply_block, [&]() { _apply_block( next_block ); } );
    } );
+   _profiler.end_block( block_num );
    return;
 }
 
@@ -557,42 +610,48 @@ void database::_apply_block( const signed_block& next_block )
 
    _issue_453_affected_assets.clear();
 
-   for( const auto& trx : next_block.transactions )
-   {
-      /* We do not need to push the undo state for each transaction
-       * because they either all apply and are valid or the
-       * entire block fails to apply.  We only need an "undo" state
-       * for transactions when validating broadcast transactions or
-       * when building a block.
-       */
-      apply_transaction( trx, skip );
-      ++_current_trx_in_block;
-   }
+   _profiler.measure( stage_transactions, [&]() {
+      for( const auto& trx : next_block.transactions )
+      {
+         /* We do not need to push the undo state for each transaction
+          * because they either all apply and are valid or the
+          * entire block fails to apply.  We only need an "undo" state
+          * for transactions when validating broadcast transactions or
+          * when building a block.
+          */
+         apply_transaction( trx, skip );
+         ++_current_trx_in_block;
+      }
+   } );
 
-   const uint32_t missed = update_witness_missed_blocks( next_block );
-   update_global_dynamic_data( next_block, missed );
-   update_signing_witness(signing_witness, next_block);
-   update_last_irreversible_block();
+   _profiler.measure( stage_block_header_updates, [&]() {
+      const uint32_t missed = update_witness_missed_blocks( next_block );
+      update_global_dynamic_data( next_block, missed );
+      update_signing_witness(signing_witness, next_block);
+      update_last_irreversible_block();
+   } );
 
    // Are we at the maintenance interval?
    if( maint_needed )
-      perform_chain_maintenance(next_block, global_props);
+      _profiler.measure( stage_chain_maintenance, [&]() { perform_chain_maintenance(next_block, global_props); } );
 
    create_block_summary(next_block);
    
-   clear_expired_transactions();
-   clear_expired_proposals();
-   clear_expired_orders();
-   proceed_bets();
-   proceed_lottery_goods();
-   proceed_matrix();
-   auto_cancel_p2p_orders();
-   auto_reset_status();
-   proceed_pledge();
-   proceed_approved_transfer();
-   update_expired_feeds();       // this will update expired feeds and some core exchange rates
-   update_core_exchange_rates(); // this will update remaining core exchange rates
-   update_withdraw_permissions();
+   _profiler.measure( stage_clear_expired_transactions, [&]() { clear_expired_transactions(); } );
+   _profiler.measure( stage_clear_expired_proposals, [&]() { clear_expired_proposals(); } );
+   _profiler.measure( stage_clear_expired_orders, [&]() { clear_expired_orders(); } );
+   _profiler.measure( stage_proceed_bets, [&]() { proceed_bets(); } );
+   _profiler.measure( stage_proceed_lottery_goods, [&]() { proceed_lottery_goods(); } );
+   _profiler.measure( stage_proceed_matrix, [&]() { proceed_matrix(); } );
+   _profiler.measure( stage_auto_cancel_p2p_orders, [&]() { auto_cancel_p2p_orders(); } );
+   _profiler.measure( stage_auto_reset_status, [&]() { auto_reset_status(); } );
+   _profiler.measure( stage_proceed_pledge, [&]() { proceed_pledge(); } );
+   _profiler.measure( stage_proceed_approved_transfer, [&]() { proceed_approved_transfer(); } );
+   // this will update expired feeds and some core exchange rates
+   _profiler.measure( stage_update_expired_feeds, [&]() { update_expired_feeds(); } );
+   // this will update remaining core exchange rates
+   _profiler.measure( stage_update_core_exchange_rates, [&]() { update_core_exchange_rates(); } );
+   _profiler.measure( stage_update_withdraw_permissions, [&]() { update_withdraw_permissions(); } );
 
    // n.b., update_maintenance_flag() happens this late
    // because get_slot_time() / get_slot_at_time() is needed above
@@ -600,15 +659,15 @@ void database::_apply_block( const signed_block& next_block )
    // update_global_dynamic_data() as perhaps these methods only need
    // to be called for header validation?
    update_maintenance_flag( maint_needed );
-   update_witness_schedule();
+   _profiler.measure( stage_update_witness_schedule, [&]() { update_witness_schedule(); } );
    if( !_node_property_object.debug_updates.empty() )
       apply_debug_updates();
 
    // notify observers that the block has been applied
-   notify_applied_block( next_block ); //emit
+   _profiler.measure( stage_notify_applied_block, [&]() { notify_applied_block( next_block ); } ); //emit
    _applied_ops.clear();
 
-   notify_changed_objects();
+   _profiler.measure( stage_notify_changed_objects, [&]() { notify_changed_objects(); } );
 } FC_CAPTURE_AND_RETHROW( (next_block.block_num()) )  }
 
 
@@ -695,9 +754,24 @@ operation_result database::apply_operation(transaction_evaluation_state& eval_st
    FC_ASSERT( u_which < _operation_evaluators.size(), "No registered evaluator for operation ${op}", ("op",op) );
    unique_ptr<op_evaluator>& eval = _operation_evaluators[ u_which ];
    FC_ASSERT( eval, "No registered evaluator for operation ${op}", ("op",op) );
+   if( !_profiler.enabled() )
+   {
+      auto op_id = push_applied_operation( op );
+      auto result = eval->evaluate( eval_state, op, true );
+      set_applied_operation_result( op_id, result );
+      return result;
+   }
+   const uint64_t start = block_profiler::ticks();
+   const size_t objects_before = _undo_db.head_object_count();
+   const size_t bytes_before = _undo_db.head_undo_bytes();
    auto op_id = push_applied_operation( op );
    auto result = eval->evaluate( eval_state, op, true );
    set_applied_operation_result( op_id, result );
+   const size_t objects_after = _undo_db.head_object_count();
+   const size_t bytes_after = _undo_db.head_undo_bytes();
+   _profiler.record_operation( i_which, block_profiler::phase_total, start,
+                               objects_after > objects_before ? objects_after - objects_before : 0,
+                               bytes_after > bytes_before ? bytes_after - bytes_before : 0 );
    return result;
 } FC_CAPTURE_AND_RETHROW( (op) ) }
 
@@ -804,4 +878,113 @@ fc::future<void> database::precompute_parallel( const precomputable_transaction&
    });
 }
 
+vector<fc::exception_ptr> database::screen_transactions( const vector<const precomputable_transaction*>& trxs )const
+{
+   vector<fc::exception_ptr> result( trxs.size() );
+   if( trxs.empty() )
+      return result;
+
+   // Only the precomputation, which does not read the state, runs on the worker pool. Reading the state there
+   // would race with the chain thread, and locking it would block pool threads that the chain thread may itself
+   // be waiting for. push_transaction() does every state check.
+   const uint32_t skip = get_node_properties().skip_flags;
+   const size_t chunks = std::min( size_t( fc::asio::default_io_service_scope::get_num_threads() ), trxs.size() );
+   const size_t chunk_size = ( trxs.size() + chunks - 1 ) / chunks;
+   std::vector<fc::future<void>> workers;
+   workers.reserve( chunks );
+   for( size_t base = 0; base < trxs.size(); base += chunk_size )
+      workers.push_back( fc::do_parallel( [this,&trxs,&result,base,chunk_size,skip] () {
+         const size_t end = std::min( base + chunk_size, trxs.size() );
+         for( size_t i = base; i < end; ++i )
+         {
+            try {
+               _precompute_parallel( trxs[i], 1, skip );
+            } catch( const fc::exception& e ) {
+               result[i] = e.dynamic_copy_exception();
+            } catch( const std::exception& e ) {
+               result[i] = std::make_shared<fc::unhandled_exception>(
+                              FC_LOG_MESSAGE( warn, "${what}", ("what",e.what()) ), std::current_exception() );
+            } catch( ... ) {
+               result[i] = std::make_shared<fc::unhandled_exception>(
+                              FC_LOG_MESSAGE( warn, "unknown exception" ), std::current_exception() );
+            }
+         }
+      }, "screen_transactions" ) );
+   for( auto& worker : workers )
+      worker.wait();
+   return result;
+}
+
+namespace {
+   /// Set while a reader thread is inside the state gate, so that nested reads do not enter it again
+   thread_local bool inside_state_read = false;
+
+   struct state_read_scope
+   {
+      state_read_scope( state_gate& gate ) : _gate( gate )
+      {
+         _gate.begin_read();
+         inside_state_read = true;
+      }
+      ~state_read_scope()
+      {
+         inside_state_read = false;
+         _gate.end_read();
+      }
+      state_gate& _gate;
+   };
+
+   /// Fulfills the promise when the reader is done with the callable, however it leaves
+   struct state_read_done
+   {
+      fc::promise<void>& done;
+      ~state_read_done() { done.set_value(); }
+   };
+}
+
+void database::set_api_reader_threads( uint16_t threads )
+{
+   _api_reader_threads.clear();
+   for( uint16_t i = 0; i < threads; ++i )
+      _api_reader_threads.emplace_back( new fc::thread( "api_reader_" + std::to_string( i ) ) );
+}
+
+void database::read_state( const std::function<void()>& f )const
+{
+   if( _api_reader_threads.empty() || inside_state_read )
+   {
+      f();
+      return;
+   }
+   fc::thread& reader = *_api_reader_threads[ _next_api_reader++ % _api_reader_threads.size() ];
+   fc::promise<void>::ptr done( new fc::promise<void>( "read_state_done" ) );
+   fc::future<void> finished( done );
+   fc::future<void> result = reader.async( [this,&f,done] () {
+      state_read_done signal{ *done };
+      state_read_scope scope( _state_gate );
+      f();
+   }, "read_state" );
+   try
+   {
+      result.wait();
+   }
+   catch( ... )
+   {
+      // f refers to the locals of the caller, which must not unwind before the reader is done with it, e.g. when
+      // the waiting fiber is canceled. Every wait of a canceled fiber throws again once it is resumed, so this only
+      // yields until the reader is done.
+      while( !finished.ready() )
+      {
+         try
+         {
+            finished.wait();
+         }
+         catch( const fc::canceled_exception& )
+         {
+         }
+      }
+      throw;
+   }
+}
+
 } }
@@ -109,10 +109,10 @@ uint32_t database::last_non_undoable_block_num() const
 
 const account_statistics_object& database::get_account_stats_by_owner( account_id_type owner )const
 {
-   auto& idx = get_index_type<account_stats_index>().indices().get<by_owner>();
-   auto itr = idx.find( owner );
-   FC_ASSERT( itr != idx.end(), "Can not find account statistics object for owner ${a}", ("a",owner) );
-   return *itr;
+   // accounts and statistics are both kept by id, which is cheaper than searching statistics by owner
+   const account_object* account = find( owner );
+   FC_ASSERT( account != nullptr, "Can not find account statistics object for owner ${a}", ("a",owner) );
+   return get( account->statistics );
 }
 
 const witness_schedule_object& database::get_witness_schedule_object()const
@@ -25,6 +25,9 @@
 #include <boost/multiprecision/integer.hpp>
 
 #include <fc/uint128.hpp>
+#include <fc/thread/parallel.hpp>
+
+#include <future>
 
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/fba_accumulator_id.hpp>
@@ -94,6 +97,18 @@ void database::perform_account_maintenance(Type tally_helper)
       }
    }
 
+   // Referrers, referral statuses and personal volumes are not touched while paying out fees,
+   // so the ancestors found by next_rewardable() can be shared between all accounts in this loop
+   struct memo_canary {
+      memo_canary(std::unique_ptr<next_rewardable_memo>& target, size_t accounts): target(target)
+      {
+         target.reset( new next_rewardable_memo( accounts ) );
+      }
+      ~memo_canary() { target.reset(); }
+   private:
+      std::unique_ptr<next_rewardable_memo>& target;
+   } memo( _next_rewardable_memo, get_index_type< account_index >().indices().size() );
+
    const auto& stats_idx = get_index_type< account_stats_index >().indices().get< by_maintenance_seq >();
    auto stats_itr = stats_idx.lower_bound( true );
 
@@ -115,57 +130,36 @@ void database::perform_account_maintenance(Type tally_helper)
 void database::perform_credit_maintenance()
 {
    const auto& stats_idx = get_index_type< account_stats_index >().indices().get< by_network_income >();
-   auto stats_itr = stats_idx.lower_bound( true );
 
-   while( stats_itr != stats_idx.end() )
+   modify_range( stats_idx.lower_bound( true ), stats_idx.end(), []( account_statistics_object& aso )
    {
-      const account_statistics_object& acc_stat = *stats_itr;
-      ++stats_itr;
-
-      modify( acc_stat, []( account_statistics_object& aso )
-      {
-         aso.first_month_income=aso.second_month_income;
-         aso.second_month_income=aso.third_month_income;
-         aso.third_month_income=aso.current_month_income;
-         aso.current_month_income=0;
-      } );
-   }
+      aso.first_month_income=aso.second_month_income;
+      aso.second_month_income=aso.third_month_income;
+      aso.third_month_income=aso.current_month_income;
+      aso.current_month_income=0;
+   } );
 }
 
 void database::perform_gr_maintenance()
 {
    const auto& stats_idx = get_index_type< account_stats_index >().indices().get< by_gr_volume >();
-   auto stats_itr = stats_idx.lower_bound( true );
 
-   while( stats_itr != stats_idx.end() )
+   modify_range( stats_idx.lower_bound( true ), stats_idx.end(), []( account_statistics_object& aso )
    {
-      const account_statistics_object& acc_stat = *stats_itr;
-      ++stats_itr;
-
-      modify( acc_stat, []( account_statistics_object& aso )
-      {
-         aso.last_period_gr=aso.current_period_gr;
-         aso.current_period_gr=0;
-      } );
-   }
+      aso.last_period_gr=aso.current_period_gr;
+      aso.current_period_gr=0;
+   } );
 }
 
 void database::perform_p2p_maintenance()
 {
    const auto& stats_idx = get_index_type< account_stats_index >().indices().get< by_p2p_rating >();
-   auto stats_itr = stats_idx.lower_bound( true );
 
-   while( stats_itr != stats_idx.end() )
+   modify_range( stats_idx.lower_bound( true ), stats_idx.end(), []( account_statistics_object& aso )
    {
-      const account_statistics_object& acc_stat = *stats_itr;
-      ++stats_itr;
-
-      modify( acc_stat, []( account_statistics_object& aso )
-      {
-         aso.p2p_first_month_rating=aso.p2p_current_month_rating;
-         aso.p2p_current_month_rating=0;
-      } );
-   }
+      aso.p2p_first_month_rating=aso.p2p_current_month_rating;
+      aso.p2p_current_month_rating=0;
+   } );
 }
 
 void database::count_gr_votes() {
@@ -783,7 +777,16 @@ void database::clear_gr_invite() {
    }
 }
 
-void database::reset_gr_rank() {
+/// Ranks handed out by proceed_gr_rank(), only written to the objects once every tier is known
+struct gr_rank_assignment
+{
+   std::map<gr_team_id_type, uint8_t> teams;
+   std::map<account_id_type, uint8_t> accounts;
+};
+
+void database::apply_gr_ranks(const gr_rank_assignment& ranks) {
+   // previously ranked accounts and teams that got no rank this time drop back to 0,
+   // the others are only modified when their rank changed
    const auto& accs_idx = get_index_type< account_index >().indices().get< by_gr_rank >();
    auto accs_itr = accs_idx.lower_bound( 1 );
 
@@ -792,12 +795,23 @@ void database::reset_gr_rank() {
       const account_object& acc = *accs_itr;
       ++accs_itr;
 
-      modify( acc, []( account_object& a )
-      {
-         a.last_gr_rank=0;
-      });
+      if( ranks.accounts.find( acc.id ) == ranks.accounts.end() )
+         modify( acc, []( account_object& a )
+         {
+            a.last_gr_rank=0;
+         });
    }
-   
+   for( const auto& account_rank : ranks.accounts )
+   {
+      const account_object& acc = get( account_rank.first );
+      const uint8_t rank = account_rank.second;
+      if( acc.last_gr_rank != rank )
+         modify( acc, [rank]( account_object& a )
+         {
+            a.last_gr_rank = rank;
+         });
+   }
+
    const auto& team_idx = get_index_type< gr_team_index >().indices().get< by_last_gr_rank >();
    auto team_itr = team_idx.lower_bound( 1 );
 
@@ -806,21 +820,27 @@ void database::reset_gr_rank() {
       const gr_team_object& team = *team_itr;
       ++team_itr;
 
-      modify( team, []( gr_team_object& t )
-      {
-         t.last_gr_rank=0;
-      });
+      if( ranks.teams.find( team.id ) == ranks.teams.end() )
+         modify( team, []( gr_team_object& t )
+         {
+            t.last_gr_rank=0;
+         });
+   }
+   for( const auto& team_rank : ranks.teams )
+   {
+      const gr_team_object& team = get( team_rank.first );
+      const uint8_t rank = team_rank.second;
+      if( team.last_gr_rank != rank )
+         modify( team, [rank]( gr_team_object& t )
+         {
+            t.last_gr_rank = rank;
+         });
    }
 }
 
-void database::assign_gr_rank_to_team(const gr_team_object& team_obj, const share_type& reward, const uint8_t& rank) {
-    modify(team_obj, [rank](gr_team_object& t)
-    {
-        t.last_gr_rank = rank;
-    });
-    modify( get(team_obj.captain), [rank](account_object& a) {
-        a.last_gr_rank = rank;
-    });
+void database::assign_gr_rank_to_team(const gr_team_object& team_obj, const share_type& reward, const uint8_t& rank, gr_rank_assignment& ranks) {
+    ranks.teams[team_obj.id] = rank;
+    ranks.accounts[team_obj.captain] = rank;
     gr_pay_rank_reward_operation  vop;
     vop.captain = team_obj.captain;
     vop.team = team_obj.id;
@@ -830,9 +850,7 @@ void database::assign_gr_rank_to_team(const gr_team_object& team_obj, const shar
     adjust_balance(team_obj.captain, asset( reward, asset_id_type(0) ));
 
     for( auto player : team_obj.players ) {
-        modify( get(player), [rank](account_object& a) {
-            a.last_gr_rank = rank;
-        });
+        ranks.accounts[player] = rank;
         gr_assign_rank_operation vop;
         vop.player = player;
         vop.team = team_obj.id;
@@ -841,7 +859,7 @@ void database::assign_gr_rank_to_team(const gr_team_object& team_obj, const shar
     }
 }
 
-share_type database::assign_gr_rank(const share_type& start_itr, const share_type& end_itr, const share_type& reward, const uint8_t& rank) {
+share_type database::assign_gr_rank(const share_type& start_itr, const share_type& end_itr, const share_type& reward, const uint8_t& rank, gr_rank_assignment& ranks) {
     share_type result = 0;
     const dynamic_global_property_object& dgpo = get_dynamic_global_properties();
 
@@ -855,7 +873,7 @@ share_type database::assign_gr_rank(const share_type& start_itr, const share_typ
         while( itr != end )
         {
             const gr_team_object& team_obj = *itr;
-            assign_gr_rank_to_team(team_obj, reward, rank);
+            assign_gr_rank_to_team(team_obj, reward, rank, ranks);
             result += reward;
             itr++;
         }
@@ -871,7 +889,7 @@ share_type database::assign_gr_rank(const share_type& start_itr, const share_typ
         while( itr != end )
         {
             const gr_team_object& team_obj = *itr;
-            assign_gr_rank_to_team(team_obj, reward, rank);
+            assign_gr_rank_to_team(team_obj, reward, rank, ranks);
             result += reward;
             itr++;
         }
@@ -881,24 +899,24 @@ share_type database::assign_gr_rank(const share_type& start_itr, const share_typ
 
 
 void database::proceed_gr_rank() {
-   reset_gr_rank();
    const dynamic_global_property_object& dgpo = get_dynamic_global_properties();
+   gr_rank_assignment ranks;
 
    share_type total_reward = 0;
    // IRON
-    total_reward += assign_gr_rank(dgpo.gr_iron_volume, dgpo.gr_bronze_volume-int64_t(1), dgpo.gr_iron_reward, 1);
+    total_reward += assign_gr_rank(dgpo.gr_iron_volume, dgpo.gr_bronze_volume-int64_t(1), dgpo.gr_iron_reward, 1, ranks);
    // BRONZE
-    total_reward += assign_gr_rank(dgpo.gr_bronze_volume, dgpo.gr_silver_volume-int64_t(1), dgpo.gr_bronze_reward, 2);
+    total_reward += assign_gr_rank(dgpo.gr_bronze_volume, dgpo.gr_silver_volume-int64_t(1), dgpo.gr_bronze_reward, 2, ranks);
    // SILVER
-    total_reward += assign_gr_rank(dgpo.gr_silver_volume, dgpo.gr_gold_volume-int64_t(1), dgpo.gr_silver_reward, 3);
+    total_reward += assign_gr_rank(dgpo.gr_silver_volume, dgpo.gr_gold_volume-int64_t(1), dgpo.gr_silver_reward, 3, ranks);
    // GOLD
-    total_reward += assign_gr_rank(dgpo.gr_gold_volume, dgpo.gr_platinum_volume-int64_t(1), dgpo.gr_gold_reward, 4);
+    total_reward += assign_gr_rank(dgpo.gr_gold_volume, dgpo.gr_platinum_volume-int64_t(1), dgpo.gr_gold_reward, 4, ranks);
    // PLATINUM
-    total_reward += assign_gr_rank(dgpo.gr_platinum_volume, dgpo.gr_diamond_volume-int64_t(1), dgpo.gr_platinum_reward, 5);
+    total_reward += assign_gr_rank(dgpo.gr_platinum_volume, dgpo.gr_diamond_volume-int64_t(1), dgpo.gr_platinum_reward, 5, ranks);
    // DIAMOND
-    total_reward += assign_gr_rank(dgpo.gr_diamond_volume, dgpo.gr_master_volume-int64_t(1), dgpo.gr_diamond_reward, 6);
+    total_reward += assign_gr_rank(dgpo.gr_diamond_volume, dgpo.gr_master_volume-int64_t(1), dgpo.gr_diamond_reward, 6, ranks);
    // MASTER
-    total_reward += assign_gr_rank(dgpo.gr_master_volume, 0, dgpo.gr_master_reward, 7);
+    total_reward += assign_gr_rank(dgpo.gr_master_volume, 0, dgpo.gr_master_reward, 7, ranks);
 
    // ELITE
 
@@ -908,8 +926,9 @@ void database::proceed_gr_rank() {
             auto itr = rank_idx.rbegin();
             for(int i = 0; i < 10; i++) {
                 const gr_team_object& team_obj = *itr;
-                if (team_obj.last_gr_rank == 7) {
-                    assign_gr_rank_to_team(team_obj, dgpo.gr_elite_reward, 8);
+                auto team_rank = ranks.teams.find(team_obj.id);
+                if (team_rank != ranks.teams.end() && team_rank->second == 7) {
+                    assign_gr_rank_to_team(team_obj, dgpo.gr_elite_reward, 8, ranks);
                     total_reward += dgpo.gr_elite_reward;
                 }
                 itr++;
@@ -923,8 +942,9 @@ void database::proceed_gr_rank() {
             auto itr = rank_idx.rbegin();
             for(int i = 0; i < 10; i++) {
                 const gr_team_object& team_obj = *itr;
-                if (team_obj.last_gr_rank == 7) {
-                    assign_gr_rank_to_team(team_obj, dgpo.gr_elite_reward, 8);
+                auto team_rank = ranks.teams.find(team_obj.id);
+                if (team_rank != ranks.teams.end() && team_rank->second == 7) {
+                    assign_gr_rank_to_team(team_obj, dgpo.gr_elite_reward, 8, ranks);
                     total_reward += dgpo.gr_elite_reward;
                 }
                 itr++;
@@ -932,6 +952,8 @@ void database::proceed_gr_rank() {
         }
     }
 
+   apply_gr_ranks(ranks);
+
    // DINAMIC ASSET DATA
    modify( get_core_dynamic_data(), [total_reward](asset_dynamic_data_object& d) {
       d.current_supply += total_reward;
@@ -1048,25 +1070,51 @@ void database::proceed_apostolos() {
 
 void database::reset_gr_volumes() {
    const auto& team_idx = get_index_type< gr_team_index >().indices().get< by_total_volume >();
-   auto team_itr = team_idx.lower_bound( 1 );
 
-   while( team_itr != team_idx.end() )
+   modify_range( team_idx.lower_bound( 1 ), team_idx.end(), []( gr_team_object& t )
    {
-      const gr_team_object& team = *team_itr;
-      ++team_itr;
+      t.gr_interval_2_volume = 0;
+      t.gr_interval_4_volume = 0;
+      t.gr_interval_6_volume = 0;
+      t.gr_interval_9_volume = 0;
+      t.gr_interval_11_volume = 0;
+      t.gr_interval_13_volume = 0;
+      t.first_half_volume = 0;
+      t.second_half_volume = 0;
+      t.total_volume = 0;
+   });
+};
 
-      modify( team, []( gr_team_object& t )
-      {
-         t.gr_interval_2_volume = 0;
-         t.gr_interval_4_volume = 0;
-         t.gr_interval_6_volume = 0;
-         t.gr_interval_9_volume = 0;
-         t.gr_interval_11_volume = 0;
-         t.gr_interval_13_volume = 0;
-         t.first_half_volume = 0;
-         t.second_half_volume = 0;
-         t.total_volume = 0;
-      });
+/// Sum and count of the PoC votes that remain after cutting filter_percent of the votes off both ends
+struct trimmed_poc_votes
+{
+   share_type sum = 0;
+   size_t     count = 0;
+
+   trimmed_poc_votes() {}
+   trimmed_poc_votes( vector<share_type>& votes, uint16_t filter_percent )
+   {
+      const size_t filter = votes.size() * filter_percent / GRAPHENE_100_PERCENT;
+      if( 2 * filter >= votes.size() )
+         return;
+      // partitioning around both cut points leaves exactly the middle of the sorted votes in between them,
+      // the order within the middle does not matter for the sum
+      const auto first = votes.begin() + filter;
+      const auto last = votes.end() - filter;
+      std::nth_element( votes.begin(), first, votes.end() );
+      std::nth_element( first, last, votes.end() );
+      for( auto itr = first; itr != last; ++itr )
+         sum += *itr;
+      count = last - first;
+   }
+
+   uint64_t percent()const
+   {
+      fc::uint128 result( sum.value );
+      result /= count;
+      result /= GRAPHENE_BLOCKCHAIN_PRECISION;
+      result *= GRAPHENE_1_PERCENT;
+      return result.to_uint64();
    }
 };
 
@@ -1080,10 +1128,9 @@ void database::count_poc_votes() {
    vector<share_type> poc6_votes;
    vector<share_type> poc12_votes;
 
-   while( stats_itr != stats_idx.end() )
+   for( ; stats_itr != stats_idx.end(); ++stats_itr )
    {
       const account_statistics_object& acc_stat = *stats_itr;
-      ++stats_itr;
       if (acc_stat.poc3_vote>0) {
          poc3_votes.emplace_back(acc_stat.poc3_vote);
       }
@@ -1093,30 +1140,51 @@ void database::count_poc_votes() {
       if (acc_stat.poc12_vote>0) {
          poc12_votes.emplace_back(acc_stat.poc12_vote);
       }
-      modify(acc_stat, [](account_statistics_object& clear_stat)
-      {
-         clear_stat.poc3_vote = 0;
-         clear_stat.poc6_vote = 0;
-         clear_stat.poc12_vote = 0;
-      });
    }
-   if (poc3_votes.size()>=gpo.staking_parameters.poc_min_votes) {
-      std::sort(poc3_votes.begin(), poc3_votes.end());
-      auto poc3_length = poc3_votes.size();
-      auto poc3_filter = poc3_length*gpo.staking_parameters.poc_filter_percent/GRAPHENE_100_PERCENT;
-      vector<share_type> poc3_votes_filtered(poc3_votes.begin()+poc3_filter, poc3_votes.end()-poc3_filter);
-      share_type poc3_vote_sum = 0;
-      for( auto poc3_vote : poc3_votes_filtered ) {
-         poc3_vote_sum+=poc3_vote;
+   modify_range( stats_idx.lower_bound( true ), stats_idx.end(), [](account_statistics_object& clear_stat)
+   {
+      clear_stat.poc3_vote = 0;
+      clear_stat.poc6_vote = 0;
+      clear_stat.poc12_vote = 0;
+   });
+
+   const size_t min_votes = gpo.staking_parameters.poc_min_votes;
+   const uint16_t filter_percent = gpo.staking_parameters.poc_filter_percent;
+   vector<share_type>* buckets[] = { &poc3_votes, &poc6_votes, &poc12_votes };
+   trimmed_poc_votes results[3];
+   if( _parallel_vote_tally )
+   {
+      // Block this thread instead of waiting on fc futures, see vote_tally_helper::finish()
+      vector<std::future<void>> workers;
+      for( size_t i = 0; i < 3; ++i )
+      {
+         if( buckets[i]->size() < min_votes )
+            continue;
+         auto done = std::make_shared<std::promise<void>>();
+         workers.push_back( done->get_future() );
+         fc::do_parallel( [&buckets,&results,i,filter_percent,done] () {
+            try {
+               results[i] = trimmed_poc_votes( *buckets[i], filter_percent );
+               done->set_value();
+            } catch( ... ) {
+               done->set_exception( std::current_exception() );
+            }
+         });
       }
+      for( auto& worker : workers )
+         worker.get();
+   }
+   else
+   {
+      for( size_t i = 0; i < 3; ++i )
+         if( buckets[i]->size() >= min_votes )
+            results[i] = trimmed_poc_votes( *buckets[i], filter_percent );
+   }
 
-      fc::uint128 poc3_sum(poc3_vote_sum.value);
-      poc3_sum /= poc3_votes_filtered.size();
-      poc3_sum /= GRAPHENE_BLOCKCHAIN_PRECISION;
-      poc3_sum *= GRAPHENE_1_PERCENT;
-      uint64_t poc3_percent = poc3_sum.to_uint64();
+   if (poc3_votes.size()>=min_votes) {
+      uint64_t poc3_percent = results[0].percent();
 
-      ilog("====== PoC3 Sum ${s}, count ${c}, result ${r}", ("s", poc3_vote_sum)("c", poc3_votes_filtered.size())("r", poc3_percent));
+      ilog("====== PoC3 Sum ${s}, count ${c}, result ${r}", ("s", results[0].sum)("c", results[0].count)("r", poc3_percent));
 
       const dynamic_global_property_object& dgpo = get_dynamic_global_properties();
       modify(dgpo, [poc3_percent](dynamic_global_property_object& d) {
@@ -1124,46 +1192,20 @@ void database::count_poc_votes() {
       });
    }
 
-   if (poc6_votes.size()>=gpo.staking_parameters.poc_min_votes) {
-      std::sort(poc6_votes.begin(), poc6_votes.end());
-      auto poc6_length = poc6_votes.size();
-      auto poc6_filter = poc6_length*gpo.staking_parameters.poc_filter_percent/GRAPHENE_100_PERCENT;
-      vector<share_type> poc6_votes_filtered(poc6_votes.begin()+poc6_filter, poc6_votes.end()-poc6_filter);
-      share_type poc6_vote_sum = 0;
-      for( auto poc6_vote : poc6_votes_filtered ) {
-         poc6_vote_sum+=poc6_vote;
-      }
-
-      fc::uint128 poc6_sum(poc6_vote_sum.value);
-      poc6_sum /= poc6_votes_filtered.size();
-      poc6_sum /= GRAPHENE_BLOCKCHAIN_PRECISION;
-      poc6_sum *= GRAPHENE_1_PERCENT;
-      uint64_t poc6_percent = poc6_sum.to_uint64();
+   if (poc6_votes.size()>=min_votes) {
+      uint64_t poc6_percent = results[1].percent();
 
-      ilog("====== PoC6 Sum ${s}, count ${c}, result ${r}", ("s", poc6_vote_sum)("c", poc6_votes_filtered.size())("r", poc6_percent));
+      ilog("====== PoC6 Sum ${s}, count ${c}, result ${r}", ("s", results[1].sum)("c", results[1].count)("r", poc6_percent));
 
       const dynamic_global_property_object& dgpo = get_dynamic_global_properties();
       modify(dgpo, [poc6_percent](dynamic_global_property_object& d) {
          d.poc6_percent = poc6_percent;
       });
    }
-   if (poc12_votes.size()>=gpo.staking_parameters.poc_min_votes) {
-      std::sort(poc12_votes.begin(), poc12_votes.end());
-      auto poc12_length = poc12_votes.size();
-      auto poc12_filter = poc12_length*gpo.staking_parameters.poc_filter_percent/GRAPHENE_100_PERCENT;
-      vector<share_type> poc12_votes_filtered(poc12_votes.begin()+poc12_filter, poc12_votes.end()-poc12_filter);
-      share_type poc12_vote_sum = 0;
-      for( auto poc12_vote : poc12_votes_filtered ) {
-         poc12_vote_sum+=poc12_vote;
-      }
+   if (poc12_votes.size()>=min_votes) {
+      uint64_t poc12_percent = results[2].percent();
 
-      fc::uint128 poc12_sum(poc12_vote_sum.value);
-      poc12_sum /= poc12_votes_filtered.size();
-      poc12_sum /= GRAPHENE_BLOCKCHAIN_PRECISION;
-      poc12_sum *= GRAPHENE_1_PERCENT;
-      uint64_t poc12_percent = poc12_sum.to_uint64();
-
-      ilog("====== PoC12 Sum ${s}, count ${c}, result ${r}", ("s", poc12_vote_sum)("c", poc12_votes_filtered.size())("r", poc12_percent));
+      ilog("====== PoC12 Sum ${s}, count ${c}, result ${r}", ("s", results[2].sum)("c", results[2].count)("r", poc12_percent));
 
       const dynamic_global_property_object& dgpo = get_dynamic_global_properties();
       modify(dgpo, [poc12_percent](dynamic_global_property_object& d) {
@@ -2252,6 +2294,21 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
       database& d;
       const global_property_object& props;
 
+      /// Votes recorded during the account maintenance loop, to be accumulated by finish()
+      struct pending_vote {
+         const account_object* opinion_account;
+         uint64_t voting_stake;
+      };
+      vector<pending_vote> pending_votes;
+
+      /// Per-shard accumulators, merged into the database buffers in shard order
+      struct tally_buffers {
+         vector<uint64_t> votes;
+         vector<uint64_t> witness_count_histogram;
+         vector<uint64_t> committee_count_histogram;
+         uint64_t total_voting_stake = 0;
+      };
+
       vote_tally_helper(database& d, const global_property_object& gpo)
          : d(d), props(gpo)
       {
@@ -2273,47 +2330,110 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
                    GRAPHENE_PROXY_TO_SELF_ACCOUNT)? stake_account
                                      : d.get(stake_account.options.voting_account);
 
+            // The stake has to be taken now, paying out fees later in the maintenance loop may deposit cashback
             uint64_t voting_stake = stats.total_core_in_orders.value
                   + (stake_account.cashback_vb.valid() ? (*stake_account.cashback_vb)(d).balance.amount.value: 0)
                   + stats.core_in_balance.value;
 
-            for( vote_id_type id : opinion_account.options.votes )
-            {
-               uint32_t offset = id.instance();
-               // if they somehow managed to specify an illegal offset, ignore it.
-               if( offset < d._vote_tally_buffer.size() )
-                  d._vote_tally_buffer[offset] += voting_stake;
-            }
+            if( d._parallel_vote_tally )
+               pending_votes.push_back( { &opinion_account, voting_stake } );
+            else
+               tally( opinion_account, voting_stake, d._vote_tally_buffer, d._witness_count_histogram_buffer,
+                      d._committee_count_histogram_buffer, d._total_voting_stake );
+         }
+      }
 
-            if( opinion_account.options.num_witness <= props.parameters.maximum_witness_count )
-            {
-               uint16_t offset = std::min(size_t(opinion_account.options.num_witness/2),
-                                          d._witness_count_histogram_buffer.size() - 1);
-               // votes for a number greater than maximum_witness_count
-               // are turned into votes for maximum_witness_count.
-               //
-               // in particular, this takes care of the case where a
-               // member was voting for a high number, then the
-               // parameter was lowered.
-               d._witness_count_histogram_buffer[offset] += voting_stake;
-            }
-            if( opinion_account.options.num_committee <= props.parameters.maximum_committee_count )
-            {
-               uint16_t offset = std::min(size_t(opinion_account.options.num_committee/2),
-                                          d._committee_count_histogram_buffer.size() - 1);
-               // votes for a number greater than maximum_committee_count
-               // are turned into votes for maximum_committee_count.
-               //
-               // same rationale as for witnesses
-               d._committee_count_histogram_buffer[offset] += voting_stake;
-            }
+      void tally( const account_object& opinion_account, uint64_t voting_stake, vector<uint64_t>& vote_tally,
+                  vector<uint64_t>& witness_count_histogram, vector<uint64_t>& committee_count_histogram,
+                  uint64_t& total_voting_stake )const
+      {
+         for( vote_id_type id : opinion_account.options.votes )
+         {
+            uint32_t offset = id.instance();
+            // if they somehow managed to specify an illegal offset, ignore it.
+            if( offset < vote_tally.size() )
+               vote_tally[offset] += voting_stake;
+         }
 
-            d._total_voting_stake += voting_stake;
+         if( opinion_account.options.num_witness <= props.parameters.maximum_witness_count )
+         {
+            uint16_t offset = std::min(size_t(opinion_account.options.num_witness/2),
+                                       witness_count_histogram.size() - 1);
+            // votes for a number greater than maximum_witness_count
+            // are turned into votes for maximum_witness_count.
+            //
+            // in particular, this takes care of the case where a
+            // member was voting for a high number, then the
+            // parameter was lowered.
+            witness_count_histogram[offset] += voting_stake;
+         }
+         if( opinion_account.options.num_committee <= props.parameters.maximum_committee_count )
+         {
+            uint16_t offset = std::min(size_t(opinion_account.options.num_committee/2),
+                                       committee_count_histogram.size() - 1);
+            // votes for a number greater than maximum_committee_count
+            // are turned into votes for maximum_committee_count.
+            //
+            // same rationale as for witnesses
+            committee_count_histogram[offset] += voting_stake;
+         }
+
+         total_voting_stake += voting_stake;
+      }
+
+      /// Accumulates the votes recorded in parallel mode on the worker pool, one shard per thread
+      void finish()
+      {
+         if( pending_votes.empty() )
+            return;
+
+         const size_t shards = std::min( size_t( fc::asio::default_io_service_scope::get_num_threads() ),
+                                         pending_votes.size() );
+         const size_t shard_size = ( pending_votes.size() + shards - 1 ) / shards;
+         vector<tally_buffers> buffers( shards );
+         // Block this thread instead of waiting on fc futures, which would let other tasks
+         // touch the database while it is in the middle of applying a block
+         vector<std::future<void>> workers;
+         workers.reserve( shards );
+         for( size_t shard = 0; shard < shards; ++shard )
+         {
+            auto done = std::make_shared<std::promise<void>>();
+            workers.push_back( done->get_future() );
+            fc::do_parallel( [this,&buffers,shard,shard_size,done] () {
+               try {
+                  tally_buffers& buf = buffers[shard];
+                  buf.votes.resize( d._vote_tally_buffer.size() );
+                  buf.witness_count_histogram.resize( d._witness_count_histogram_buffer.size() );
+                  buf.committee_count_histogram.resize( d._committee_count_histogram_buffer.size() );
+                  const size_t end = std::min( (shard + 1) * shard_size, pending_votes.size() );
+                  for( size_t i = shard * shard_size; i < end; ++i )
+                     tally( *pending_votes[i].opinion_account, pending_votes[i].voting_stake, buf.votes,
+                            buf.witness_count_histogram, buf.committee_count_histogram, buf.total_voting_stake );
+                  done->set_value();
+               } catch( ... ) {
+                  done->set_exception( std::current_exception() );
+               }
+            });
+         }
+         for( auto& worker : workers )
+            worker.get();
+
+         for( const tally_buffers& buf : buffers )
+         {
+            for( size_t i = 0; i < buf.votes.size(); ++i )
+               d._vote_tally_buffer[i] += buf.votes[i];
+            for( size_t i = 0; i < buf.witness_count_histogram.size(); ++i )
+               d._witness_count_histogram_buffer[i] += buf.witness_count_histogram[i];
+            for( size_t i = 0; i < buf.committee_count_histogram.size(); ++i )
+               d._committee_count_histogram_buffer[i] += buf.committee_count_histogram[i];
+            d._total_voting_stake += buf.total_voting_stake;
          }
+         pending_votes.clear();
       }
    } tally_helper(*this, gpo);
 
-   perform_account_maintenance( tally_helper );
+   perform_account_maintenance( std::ref( tally_helper ) );
+   tally_helper.finish();
 
    struct clear_canary {
       clear_canary(vector<uint64_t>& target): target(target){}
@@ -23,6 +23,7 @@
  */
 
 #include <graphene/chain/database.hpp>
+#include <graphene/chain/db_with.hpp>
 
 #include <graphene/chain/chain_property_object.hpp>
 #include <graphene/chain/witness_schedule_object.hpp>
@@ -31,7 +32,9 @@
 #include <graphene/chain/protocol/fee_schedule.hpp>
 
 #include <fc/io/fstream.hpp>
+#include <fc/thread/thread.hpp>
 
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -78,26 +81,54 @@ void database::reindex( fc::path data_dir )
 
    uint32_t skip = node_properties().skip_flags;
 
+   // Blocks are read and unpacked ahead of time by a second reader of the block log on its own thread,
+   // while this thread only applies them. The replay itself keeps _block_id_to_block to itself.
+   typedef std::pair< size_t, fc::optional< signed_block > > read_result;
+   block_database reader;
+   reader.open( data_dir / "database" / "block_num_to_block" );
+   fc::thread reader_thread( "replay_reader" );
+   std::deque< fc::future< read_result > > reads;
+
    size_t total_block_size = _block_id_to_block.total_block_size();
    const auto& gpo = get_global_properties();
    std::queue< std::tuple< size_t, signed_block, fc::future< void > > > blocks;
    uint32_t next_block_num = head_block_num() + 1;
+   uint32_t next_read_num = next_block_num;
    uint32_t i = next_block_num;
+   const uint32_t first_block_num = i;
+   fc::time_point report_time = start;
+   uint32_t report_block_num = i;
    while( next_block_num <= last_block_num || !blocks.empty() )
    {
+      while( next_read_num <= last_block_num && reads.size() < 200 )
+      {
+         const uint32_t block_num = next_read_num++;
+         reads.push_back( reader_thread.async( [&reader,block_num] () {
+            const size_t processed_block_size = reader.blocks_current_position();
+            return read_result( processed_block_size, reader.fetch_by_number( block_num ) );
+         }, "replay_read" ) );
+      }
       if( next_block_num <= last_block_num && blocks.size() < 20 )
       {
-         const size_t processed_block_size = _block_id_to_block.blocks_current_position();
-         fc::optional< signed_block > block = _block_id_to_block.fetch_by_number( next_block_num++ );
+         read_result read = reads.front().wait();
+         reads.pop_front();
+         next_block_num++;
+         fc::optional< signed_block >& block = read.second;
          if( block.valid() )
          {
             if( block->timestamp >= last_block->timestamp - gpo.parameters.maximum_time_until_expiration )
                skip &= ~skip_transaction_dupe_check;
-            blocks.emplace( processed_block_size, std::move(*block), fc::future<void>() );
+            blocks.emplace( read.first, std::move(*block), fc::future<void>() );
             std::get<2>(blocks.back()) = precompute_parallel( std::get<1>(blocks.back()), skip );
          }
          else
          {
+            // the reader must not see the block log while blocks are dropped from it
+            for( auto& pending : reads )
+               pending.wait();
+            reads.clear();
+            next_read_num = last_block_num + 1;
+
             wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
             uint32_t dropped_count = 0;
             while( true )
@@ -123,15 +154,20 @@ void database::reindex( fc::path data_dir )
 
          if( i % 10000 == 0 )
          {
+            const auto now = fc::time_point::now();
+            const double seconds = double( (now - report_time).count() ) / 1000000.0;
             ilog(
-               "   [by size: ${size}%   ${processed} of ${total}]   [by num: ${num}%   ${i} of ${last}]",
+               "   [by size: ${size}%   ${processed} of ${total}]   [by num: ${num}%   ${i} of ${last}]   [${rate} blocks/sec]",
                ("size", double(std::get<0>(blocks.front())) / total_block_size * 100)
                ("processed", std::get<0>(blocks.front()))
                ("total", total_block_size)
                ("num", double(i*100)/last_block_num)
                ("i", i)
                ("last", last_block_num)
+               ("rate", seconds > 0 ? uint64_t( (i - report_block_num) / seconds ) : 0)
             );
+            report_time = now;
+            report_block_num = i;
          }
          if( i == flush_point )
          {
@@ -140,7 +176,15 @@ void database::reindex( fc::path data_dir )
             ilog( "Done" );
          }
          if( i < undo_point )
+         {
             apply_block( block, skip );
+            if( _replay_checkpoint_interval > 0 && i % _replay_checkpoint_interval == 0 && i < flush_point )
+            {
+               // a node that is restarted without --replay-blockchain continues the replay from here
+               ilog( "Writing replay checkpoint at block ${i}", ("i",i) );
+               flush();
+            }
+         }
          else
          {
             _undo_db.enable();
@@ -152,7 +196,9 @@ void database::reindex( fc::path data_dir )
    }
    _undo_db.enable();
    auto end = fc::time_point::now();
-   ilog( "Done reindexing, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
+   const double seconds = double((end-start).count())/1000000.0;
+   ilog( "Done reindexing, elapsed time: ${t} sec, ${rate} blocks/sec",
+         ("t",seconds)("rate", seconds > 0 ? uint64_t( (i - first_block_num) / seconds ) : 0) );
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
 
 void database::wipe(const fc::path& data_dir, bool include_blocks)
@@ -225,6 +271,8 @@ void database::close(bool rewind)
    if (!_opened)
       return;
       
+   detail::state_write_guard write_guard( _state_gate );
+
    // TODO:  Save pending tx's on close()
    clear_pending();
 
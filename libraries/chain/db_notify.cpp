@@ -1,4 +1,7 @@
 #include <fc/container/flat.hpp>
+#include <fc/thread/parallel.hpp>
+
+#include <future>
 
 #include <graphene/chain/protocol/authority.hpp>
 #include <graphene/chain/protocol/operations.hpp>
@@ -862,6 +865,71 @@ void get_relevant_accounts( const object* obj, flat_set<account_id_type>& accoun
    }
 } // end get_relevant_accounts( const object* obj, flat_set<account_id_type>& accounts )
 
+namespace {
+
+/// Below this many objects the impacted accounts are collected on the calling thread
+const size_t min_objects_per_impacted_shard = 1024;
+
+/**
+ *  @return the accounts impacted by the non null objects in objs. Large sets are split in shards that are
+ *  processed on the worker pool.
+ */
+flat_set<account_id_type> collect_relevant_accounts( const vector<const object*>& objs )
+{
+   const size_t shards = std::max<size_t>( 1, std::min<size_t>( fc::asio::default_io_service_scope::get_num_threads(),
+                                                                objs.size() / min_objects_per_impacted_shard ) );
+   const size_t shard_size = ( objs.size() + shards - 1 ) / shards;
+   vector<vector<account_id_type>> found( shards );
+   auto collect = [&objs,&found,shard_size]( size_t shard ) {
+      flat_set<account_id_type> accounts;
+      const size_t end = std::min( ( shard + 1 ) * shard_size, objs.size() );
+      for( size_t i = shard * shard_size; i < end; ++i )
+      {
+         if( objs[i] == nullptr )
+            continue;
+         accounts.clear();
+         get_relevant_accounts( objs[i], accounts );
+         found[shard].insert( found[shard].end(), accounts.begin(), accounts.end() );
+      }
+   };
+
+   if( shards == 1 )
+      collect( 0 );
+   else
+   {
+      // Block this thread instead of waiting on fc futures, which would let other tasks
+      // touch the database while it is in the middle of applying a block
+      vector<std::future<void>> workers;
+      workers.reserve( shards );
+      for( size_t shard = 0; shard < shards; ++shard )
+      {
+         auto done = std::make_shared<std::promise<void>>();
+         workers.push_back( done->get_future() );
+         fc::do_parallel( [&collect,shard,done] () {
+            try {
+               collect( shard );
+               done->set_value();
+            } catch( ... ) {
+               done->set_exception( std::current_exception() );
+            }
+         });
+      }
+      for( auto& worker : workers )
+         worker.wait();
+      for( auto& worker : workers )
+         worker.get();
+   }
+
+   vector<account_id_type> all = std::move( found.front() );
+   for( size_t shard = 1; shard < shards; ++shard )
+      all.insert( all.end(), found[shard].begin(), found[shard].end() );
+   std::sort( all.begin(), all.end() );
+   all.erase( std::unique( all.begin(), all.end() ), all.end() );
+   return flat_set<account_id_type>( boost::container::ordered_unique_range, all.begin(), all.end() );
+}
+
+} // anonymous namespace
+
 namespace graphene { namespace chain {
 
 void database::notify_applied_block( const signed_block& block )
@@ -878,57 +946,53 @@ void database::notify_changed_objects()
 { try {
    if( _undo_db.enabled() ) 
    {
+      if( new_objects.empty() && changed_objects.empty() && removed_objects.empty() && object_changes.empty() )
+         return;
+
       const auto& head_undo = _undo_db.head();
+      auto changes = std::make_shared<object_change_set>();
 
       // New
-      if( !new_objects.empty() )
+      changes->new_ids.reserve( head_undo.new_ids.size() );
+      changes->new_objects.reserve( head_undo.new_ids.size() );
+      for( const auto& item : head_undo.new_ids )
       {
-        vector<object_id_type> new_ids;  new_ids.reserve(head_undo.new_ids.size());
-        flat_set<account_id_type> new_accounts_impacted;
-        for( const auto& item : head_undo.new_ids )
-        {
-          new_ids.push_back(item);
-          auto obj = find_object(item);
-          if(obj != nullptr)
-            get_relevant_accounts(obj, new_accounts_impacted);
-        }
-
-        if( new_ids.size() )
-           GRAPHENE_TRY_NOTIFY( new_objects, new_ids, new_accounts_impacted)
+        changes->new_ids.push_back( item );
+        changes->new_objects.push_back( find_object( item ) );
       }
+      changes->new_accounts_impacted = collect_relevant_accounts( changes->new_objects );
 
-      // Changed
-      if( !changed_objects.empty() )
+      // Changed, the impacted accounts are those of the old values
+      vector<const object*> old_values; old_values.reserve( head_undo.old_values.size() );
+      changes->changed_ids.reserve( head_undo.old_values.size() );
+      changes->changed_objects.reserve( head_undo.old_values.size() );
+      for( const auto& item : head_undo.old_values )
       {
-        vector<object_id_type> changed_ids;  changed_ids.reserve(head_undo.old_values.size());
-        flat_set<account_id_type> changed_accounts_impacted;
-        for( const auto& item : head_undo.old_values )
-        {
-          changed_ids.push_back(item.first);
-          get_relevant_accounts(item.second.get(), changed_accounts_impacted);
-        }
-
-        if( changed_ids.size() )
-           GRAPHENE_TRY_NOTIFY( changed_objects, changed_ids, changed_accounts_impacted)
+        changes->changed_ids.push_back( item.first );
+        changes->changed_objects.push_back( find_object( item.first ) );
+        old_values.push_back( item.second.get() );
       }
+      changes->changed_accounts_impacted = collect_relevant_accounts( old_values );
 
       // Removed
-      if( !removed_objects.empty() )
+      changes->removed_ids.reserve( head_undo.removed.size() );
+      changes->removed_objects.reserve( head_undo.removed.size() );
+      for( const auto& item : head_undo.removed )
       {
-        vector<object_id_type> removed_ids; removed_ids.reserve( head_undo.removed.size() );
-        vector<const object*> removed; removed.reserve( head_undo.removed.size() );
-        flat_set<account_id_type> removed_accounts_impacted;
-        for( const auto& item : head_undo.removed )
-        {
-          removed_ids.emplace_back( item.first );
-          auto obj = item.second.get();
-          removed.emplace_back( obj );
-          get_relevant_accounts(obj, removed_accounts_impacted);
-        }
-
-        if( removed_ids.size() )
-           GRAPHENE_TRY_NOTIFY( removed_objects, removed_ids, removed, removed_accounts_impacted)
+        changes->removed_ids.push_back( item.first );
+        changes->removed_objects.push_back( item.second.get() );
       }
+      changes->removed_accounts_impacted = collect_relevant_accounts( changes->removed_objects );
+
+      if( changes->new_ids.size() )
+         GRAPHENE_TRY_NOTIFY( new_objects, changes->new_ids, changes->new_accounts_impacted )
+      if( changes->changed_ids.size() )
+         GRAPHENE_TRY_NOTIFY( changed_objects, changes->changed_ids, changes->changed_accounts_impacted )
+      if( changes->removed_ids.size() )
+         GRAPHENE_TRY_NOTIFY( removed_objects, changes->removed_ids, changes->removed_objects,
+                              changes->removed_accounts_impacted )
+      if( changes->new_ids.size() || changes->changed_ids.size() || changes->removed_ids.size() )
+         GRAPHENE_TRY_NOTIFY( object_changes, std::shared_ptr<const object_change_set>( std::move( changes ) ) )
    }
 } FC_CAPTURE_AND_LOG( (0) ) }
 
@@ -310,21 +310,33 @@ void database::auto_reset_status()
 
 }
 
+/**
+ * Returns the orders in the given status whose deadline is strictly before @p now, in id order.
+ *
+ * @p idx is one of the (status, deadline, id) indexes, so only the expired prefix of the
+ * status range is visited instead of every open order. The result is re-sorted by id to
+ * keep the order in which virtual operations are emitted identical to a by_status scan.
+ */
+template<typename StatusTimeIndex>
+static vector<p2p_order_object> due_p2p_orders( const StatusTimeIndex& idx, uint8_t status, time_point_sec now )
+{
+   vector<p2p_order_object> result;
+   auto itr = idx.lower_bound( boost::make_tuple( status ) );
+   auto end = idx.lower_bound( boost::make_tuple( status, now ) );
+   for( ; itr != end; ++itr )
+      result.emplace_back( *itr );
+   std::sort( result.begin(), result.end(), []( const p2p_order_object& a, const p2p_order_object& b ) {
+      return a.id < b.id;
+   });
+   return result;
+}
+
 void database::auto_cancel_p2p_orders()
 {
 	auto head_time = head_block_time();
    if ( head_time >= HARDFORK_CWD3_TIME ) {
-      const auto& po_idx_approve = get_index_type<p2p_order_index>().indices().get<by_status>();
-      auto itr0 = po_idx_approve.equal_range(1);
-      vector<p2p_order_object> orders_to_remove_1;
-
-      std::for_each(itr0.first, itr0.second, [&](const p2p_order_object& current_p2p_order) {
-         if (current_p2p_order.time_for_approve < head_time && current_p2p_order.status == 1 ) {
-            // elog( "auto_cancel_p2p_orders, only cancel (status 1), head_time  ${e}", ("e", head_time) );
-            // elog( "auto_cancel_p2p_orders, only cancel (status 1), current_order  ${e}", ("e", current_p2p_order.time_for_approve) );
-            orders_to_remove_1.emplace_back(current_p2p_order);
-         }
-      });
+      const auto& po_idx = get_index_type<p2p_order_index>().indices();
+      vector<p2p_order_object> orders_to_remove_1 = due_p2p_orders( po_idx.get<by_status_time_for_approve>(), 1, head_time );
       if (orders_to_remove_1.size()>0) {
          // elog( "auto_cancel_p2p_orders, only cancel (status 1), orders_to_remove_1 before remove  ${e}", ("e", orders_to_remove_1) );
          for( auto order : orders_to_remove_1 ) {
@@ -352,16 +364,7 @@ void database::auto_cancel_p2p_orders()
       }
 
       
-      const auto& po_idx_reply = get_index_type<p2p_order_index>().indices().get<by_status>();
-      auto itr1 = po_idx_reply.equal_range(2);
-      vector<p2p_order_object> orders_to_remove_2;
-      std::for_each(itr1.first, itr1.second, [&](const p2p_order_object& current_p2p_order) {
-         if (current_p2p_order.time_for_reply < head_time  && current_p2p_order.status == 2) {
-            // elog( "auto_cancel_p2p_orders, cancel and refund (status 2), head_time  ${e}", ("e", head_time) );
-            // elog( "auto_cancel_p2p_orders, cancel and refund (status 2), current_order  ${e}", ("e", current_p2p_order.time_for_reply) );
-            orders_to_remove_2.emplace_back(current_p2p_order);
-         }
-      });
+      vector<p2p_order_object> orders_to_remove_2 = due_p2p_orders( po_idx.get<by_status_time_for_reply>(), 2, head_time );
 
       if (orders_to_remove_2.size()>0) {
          // elog( "auto_cancel_p2p_orders, cancel and refund (status 2), orders_to_remove_2 before remove  ${e}", ("e", orders_to_remove_2) );
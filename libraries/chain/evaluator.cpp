@@ -39,6 +39,7 @@
 
 namespace graphene { namespace chain {
 database& generic_evaluator::db()const { return trx_state->db(); }
+block_profiler& generic_evaluator::profiler()const { return db().get_profiler(); }
 
    operation_result generic_evaluator::start_evaluate( transaction_evaluation_state& eval_state, const operation& op, bool apply )
    { try {
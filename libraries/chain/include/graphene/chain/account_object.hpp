@@ -194,7 +194,7 @@ class account_statistics_object : public graphene::db::abstract_object<account_s
    /**
           * Update network volume
           */
-   void update_nv(share_type volume, uint8_t level, uint16_t max_reward_level, const account_object &a, database &d, std::set<account_id_type> account_set) const;
+   void update_nv(share_type volume, uint8_t level, uint16_t max_reward_level, const account_object &a, database &d, std::set<account_id_type> &account_set) const;
    share_type get_nv(database &d) const;
    /**
           * Update personal volume
@@ -394,7 +394,6 @@ class account_object : public graphene::db::abstract_object<account_object>
         }
    }
    account_id_type get_id() const { return id; }
-//    account_id_type next_rewardable(const account_object &a, database &d) ;
 };
 
 /**
@@ -425,9 +424,35 @@ class account_member_index : public secondary_index
    set<address> before_address_members;
 };
 
+/**
+    *  @brief Position of an account in the referral tree together with aggregates over its downline
+    *
+    *  Volumes are the stored @ref account_statistics_object::personal_volume_in_period values, the
+    *  time decay applied by @ref account_statistics_object::get_pv is not included.
+    */
+struct referral_tree_node
+{
+   /// The referrer, or the account itself if it is a root of the tree
+   account_id_type referrer;
+   /// Number of hops to the root of the tree
+   uint32_t depth = 0;
+   /// Number of accounts referred directly by this account
+   uint32_t direct_referrals = 0;
+   /// Number of accounts in the downline, not counting this account
+   uint64_t downline_size = 0;
+   /// Stored personal volume of this account
+   share_type personal_volume = 0;
+   /// Sum of the stored personal volumes of the downline, not counting this account
+   share_type downline_volume = 0;
+};
+
 /**
     *  @brief This secondary index will allow a reverse lookup of all accounts that have been referred by
     *  a particular account.
+    *
+    *  It also materializes the referral tree: the depth of every account and the size and personal volume
+    *  of its downline are updated incrementally, walking only the ancestors of the account that changed.
+    *  Personal volumes are fed by @ref referral_volume_index.
     */
 class account_referrer_index : public secondary_index
 {
@@ -439,6 +464,44 @@ class account_referrer_index : public secondary_index
 
    /** maps the referrer to the set of accounts that they have referred */
    map<account_id_type, set<account_id_type>> referred_by;
+
+   /// @return the tree node of the account, or nullptr if the account is unknown
+   const referral_tree_node *find_node(account_id_type acct) const;
+
+   /// Called by @ref referral_volume_index when the stored personal volume of an account changes
+   void set_personal_volume(account_id_type acct, share_type volume);
+
+ private:
+   referral_tree_node &get_or_create_node(account_id_type acct);
+   bool is_root(account_id_type acct) const;
+   /// Adds the downline of @p acct (including itself) to all of its ancestors
+   void attach(account_id_type acct, account_id_type referrer);
+   /// Removes the downline of @p acct (including itself) from all of its ancestors
+   void detach(account_id_type acct);
+   /// Recomputes the depth of everything below @p acct after it has moved
+   void update_depths(account_id_type acct);
+
+   /** account instance => tree node, valid when the instance is in @ref known */
+   vector<referral_tree_node> nodes;
+   vector<bool> known;
+   std::stack<account_id_type> referrers_being_modified;
+};
+
+/**
+    *  @brief This secondary index of the account statistics forwards changes of the stored personal volume
+    *         to the referral tree kept by @ref account_referrer_index.
+    */
+class referral_volume_index : public secondary_index
+{
+ public:
+   explicit referral_volume_index(account_referrer_index *tree) : tree(tree) {}
+
+   virtual void object_inserted(const object &obj) override;
+   virtual void object_removed(const object &obj) override;
+   virtual void object_modified(const object &after) override;
+
+ private:
+   account_referrer_index *tree;
 };
 
 /**
@@ -465,6 +528,27 @@ class balances_by_account_index : public secondary_index
    std::stack<object_id_type> ids_being_modified;
 };
 
+/**
+    *  @brief This secondary index counts the balance objects of every asset, so that
+    *         the number of holders of an asset is known without walking its balances.
+    */
+class holders_by_asset_index : public secondary_index
+{
+ public:
+   virtual void object_inserted(const object &obj) override;
+   virtual void object_removed(const object &obj) override;
+   virtual void about_to_modify(const object &before) override;
+   virtual void object_modified(const object &after) override;
+
+   /** @return the number of balance objects of the asset, including those with a zero balance */
+   uint64_t get_balance_count(const asset_id_type &asset) const;
+
+ private:
+   /** Number of balance objects by asset instance */
+   vector<uint64_t> counts;
+   std::stack<asset_id_type> assets_being_modified;
+};
+
 struct by_asset_balance;
 struct by_maintenance_flag;
 /**
@@ -582,6 +666,9 @@ FC_REFLECT_DERIVED(graphene::chain::account_object,
                    (graphene::db::object),
                    (membership_expiration_date)(registrar)(referrer)(lifetime_referrer)(network_fee_percentage)(lifetime_referrer_fee_percentage)(referrer_rewards_percentage)(name)(owner)(active)(options)(statistics)(whitelisting_accounts)(blacklisting_accounts)(whitelisted_accounts)(blacklisted_accounts)(cashback_vb)(owner_special_authority)(active_special_authority)(top_n_control_flags)(allowed_assets)(referral_levels)(referral_status_type)(referral_status_paid_fee)(referral_status_expiration_date)(status_denominator)(gr_team)(apostolos)(last_gr_rank))
 
+FC_REFLECT(graphene::chain::referral_tree_node,
+           (referrer)(depth)(direct_referrals)(downline_size)(personal_volume)(downline_volume))
+
 FC_REFLECT_DERIVED(graphene::chain::account_balance_object,
                    (graphene::db::object),
                    (owner)(asset_type)(balance)(maintenance_flag))
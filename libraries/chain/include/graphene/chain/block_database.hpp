@@ -22,8 +22,13 @@
  * THE SOFTWARE.
  */
 #pragma once
+#include <atomic>
 #include <fstream>
 #include <graphene/chain/protocol/block.hpp>
+#include <graphene/chain/compressed_block_log.hpp>
+#include <fc/interprocess/file_mapping.hpp>
+
+#include <boost/thread/shared_mutex.hpp>
 
 namespace graphene { namespace chain {
    struct index_entry;
@@ -47,10 +52,53 @@ namespace graphene { namespace chain {
          optional<block_id_type> last_id()const;
          size_t                 blocks_current_position()const;
          size_t                 total_block_size()const;
+
+         /**
+          * Serve contains(), fetch_block_id(), fetch_optional() and fetch_by_number() from read-only
+          * memory mappings of the index and the block log. Blocks are unpacked straight from the mapping,
+          * and these calls may be made concurrently from several threads while blocks are being stored.
+          */
+         void enable_mapped_reads( bool enable );
+
+         /**
+          * Store the blocks of a newly created block database in a compressed_block_log instead of the raw
+          * blocks file. Has to be called before open(); an existing block database keeps the format it was
+          * created with.
+          */
+         void enable_compression( bool enable, uint32_t frame_size, uint32_t cached_frames );
       private:
+         /// A read-only mapping of a file that only ever grows while it is open
+         struct mapped_file
+         {
+            fc::path                           path;
+            std::unique_ptr<fc::file_mapping>  file;
+            std::unique_ptr<fc::mapped_region> region;
+         };
+
          optional<index_entry> last_index_entry()const;
+         /// @return false if the block log is shorter than the entry claims
+         bool read_block_data( const index_entry& e, vector<char>& data )const;
+
+         /// Calls reader with a pointer to [pos, pos + size) of the mapped file, remapping it if it has grown
+         /// @return false if the file is shorter than pos + size
+         template<typename Reader>
+         bool read_mapped( mapped_file& mf, uint64_t pos, uint64_t size, Reader&& reader )const;
+         bool read_mapped_index_entry( uint32_t block_num, index_entry& e )const;
+         optional<signed_block> read_mapped_block( const index_entry& e )const;
+         void reset_mappings()const;
+
          fc::path _index_filename;
          mutable std::fstream _blocks;
          mutable std::fstream _block_num_to_pos;
+
+         bool                         _compress_new_logs = false;
+         bool                         _compressed = false;
+         compressed_block_log         _compressed_blocks;
+         mutable std::atomic<uint64_t> _compressed_read_pos;
+
+         bool                         _mapped_reads = false;
+         mutable mapped_file          _mapped_index;
+         mutable mapped_file          _mapped_blocks;
+         mutable boost::shared_mutex  _mapping_mutex;
    };
 } }
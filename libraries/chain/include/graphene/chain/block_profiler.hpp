@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+#include <array>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fc/reflect/reflect.hpp>
+
+namespace graphene { namespace chain {
+
+   /// Sections of database::_apply_block that are timed by the block_profiler
+   enum block_stage
+   {
+      stage_apply_block,
+      stage_transactions,
+      stage_block_header_updates,
+      stage_chain_maintenance,
+      stage_clear_expired_transactions,
+      stage_clear_expired_proposals,
+      stage_clear_expired_orders,
+      stage_proceed_bets,
+      stage_proceed_lottery_goods,
+      stage_proceed_matrix,
+      stage_auto_cancel_p2p_orders,
+      stage_auto_reset_status,
+      stage_proceed_pledge,
+      stage_proceed_approved_transfer,
+      stage_update_expired_feeds,
+      stage_update_core_exchange_rates,
+      stage_update_withdraw_permissions,
+      stage_update_witness_schedule,
+      stage_notify_applied_block,
+      stage_notify_changed_objects,
+      block_stage_count
+   };
+
+   /// Reported statistics of one profiled section, times are in nanoseconds
+   struct profile_summary
+   {
+      std::string name;
+      uint64_t    count = 0;
+      uint64_t    total_ns = 0;
+      uint64_t    p50_ns = 0;
+      uint64_t    p99_ns = 0;
+      uint64_t    max_ns = 0;
+      /// objects first touched in the undo state of the block, only for whole operations
+      uint64_t    objects_touched = 0;
+      /// bytes of undo pre-images recorded, only for whole operations
+      uint64_t    undo_bytes = 0;
+   };
+
+   /**
+    * @brief Latency histogram of one profiled section
+    *
+    * Durations are kept in CPU ticks, in buckets of a quarter power of two each, so percentiles are exact up to
+    * 25% of their value. Durations of 2^41 ticks and more all land in the last bucket.
+    */
+   struct profile_stats
+   {
+      static const size_t bucket_count = 160;
+
+      uint64_t                             count = 0;
+      uint64_t                             total = 0;
+      uint64_t                             max = 0;
+      uint64_t                             objects = 0;
+      uint64_t                             undo_bytes = 0;
+      std::array<uint32_t, bucket_count>   buckets{};
+
+      void     record( uint64_t ticks, uint64_t touched_objects = 0, uint64_t bytes = 0 );
+      void     merge( const profile_stats& other );
+      /// @return the lower bound of the bucket holding the given fraction of all samples
+      uint64_t percentile( double fraction )const;
+   };
+
+   /**
+    * @brief Opt-in latency profiler of block application
+    *
+    * Times every stage of database::_apply_block as well as the evaluation and application of every operation type.
+    * Samples are taken with the time stamp counter where available and go to unsynchronized buffers of the thread
+    * that applies blocks; they are published once per block by end_block(), which is the only place that locks.
+    * When disabled, the cost is one branch per profiled section.
+    */
+   class block_profiler
+   {
+      public:
+         enum operation_phase
+         {
+            phase_evaluate,
+            phase_apply,
+            /// database::apply_operation, i.e. both phases plus fee handling and operation history
+            phase_total,
+            operation_phase_count
+         };
+
+         /// @param log_interval number of blocks between two summary log lines, 0 to never log
+         void enable( bool enable, uint32_t log_interval );
+         bool enabled()const { return _enabled; }
+
+         /// @return a time stamp in ticks, only differences of them are meaningful
+         static uint64_t ticks();
+
+         void record_stage( block_stage stage, uint64_t start_ticks )
+         {
+            _stages[stage].record( ticks() - start_ticks );
+         }
+         void record_operation( int op_type, operation_phase phase, uint64_t start_ticks,
+                                uint64_t touched_objects = 0, uint64_t bytes = 0 );
+
+         /// Runs f and records its duration as the given stage if profiling is enabled
+         template<typename Lambda>
+         void measure( block_stage stage, Lambda&& f )
+         {
+            if( !_enabled )
+            {
+               f();
+               return;
+            }
+            const uint64_t start = ticks();
+            f();
+            record_stage( stage, start );
+         }
+
+         /// Publishes the samples taken since the last call and logs a summary every log_interval blocks
+         void end_block( uint32_t block_num );
+
+         /// Statistics since the profiler was enabled or reset, safe to call from any thread
+         std::vector<profile_summary> get_stage_profile()const;
+         std::vector<profile_summary> get_operation_profile()const;
+         void                         reset();
+
+      private:
+         struct stats_set
+         {
+            std::array<profile_stats, block_stage_count> stages;
+            std::vector<profile_stats>                   operations;
+            void clear();
+         };
+
+         /// @return nanoseconds per tick as measured between enabling the profiler and now
+         double ns_per_tick()const;
+         profile_summary summarize( const std::string& name, const profile_stats& stats, double scale )const;
+         void log_interval( uint32_t block_num );
+
+         bool                                          _enabled = false;
+         uint32_t                                      _log_interval = 0;
+         uint64_t                                      _start_ticks = 0;
+         int64_t                                       _start_ns = 0;
+
+         /// written by the thread that applies blocks only
+         std::array<profile_stats, block_stage_count>  _stages;
+         std::vector<profile_stats>                    _operations;
+         std::vector<bool>                             _touched_operations;
+
+         stats_set                                     _interval;
+         mutable std::mutex                            _totals_mutex;
+         stats_set                                     _totals;
+   };
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::profile_summary,
+            (name)(count)(total_ns)(p50_ns)(p99_ns)(max_ns)(objects_touched)(undo_bytes) )
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <fc/filesystem.hpp>
+
+namespace graphene { namespace chain {
+
+   /**
+    * @brief Append-only byte log that stores its contents as independently compressed zlib frames
+    *
+    * The log is addressed by logical positions, i.e. positions in the uncompressed byte stream, so that
+    * block_database can keep its index entries unchanged and only swap the storage of the block bytes.
+    * Appended records are collected in an uncompressed tail, which is persisted as it grows and sealed into
+    * a new frame once it reaches the frame size. A record never spans two frames, so any record can be read
+    * by decompressing exactly one frame. Recently decompressed frames are kept in a small LRU cache.
+    *
+    * Files in the log directory:
+    *  - blocks.frames:      the compressed frames, back to back
+    *  - blocks.frame_index: one frame_entry per frame
+    *  - blocks.tail:        logical position of the tail followed by the records appended since the last frame
+    */
+   class compressed_block_log
+   {
+      public:
+         static bool exists( const fc::path& dir );
+         static void remove( const fc::path& dir );
+
+         void open( const fc::path& dir );
+         bool is_open()const;
+         void flush();
+         void close();
+
+         /// @return the logical position of data in the log
+         uint64_t append( const std::vector<char>& data );
+         /// @return false if [pos, pos + size) is not contained in the log
+         bool     read( uint64_t pos, uint32_t size, std::vector<char>& data )const;
+         /// @return the logical size of the log
+         uint64_t size()const;
+
+         void set_frame_size( uint32_t bytes ) { _frame_size = bytes; }
+         void set_cache_size( uint32_t frames ) { _cache_size = frames; }
+
+      private:
+         struct frame_entry
+         {
+            uint64_t logical_pos = 0;
+            uint64_t file_pos = 0;
+            uint32_t compressed_size = 0;
+            uint32_t logical_size = 0;
+         };
+         typedef std::shared_ptr<const std::string> frame_data;
+
+         void       seal_tail();
+         void       reset_tail_file();
+         frame_data load_frame( size_t frame )const;
+         void       cache_frame( size_t frame, const frame_data& data )const;
+
+         fc::path                  _tail_filename;
+         std::vector<frame_entry>  _frames;
+         std::string               _tail;
+         uint64_t                  _tail_pos = 0;
+         uint32_t                  _frame_size = 1024 * 1024;
+         uint32_t                  _cache_size = 16;
+
+         mutable std::fstream      _frame_file;
+         mutable std::fstream      _frame_index_file;
+         mutable std::fstream      _tail_file;
+
+         /// most recently used frames first
+         mutable std::list< std::pair<size_t, frame_data> >                                     _cache;
+         mutable std::unordered_map< size_t, std::list< std::pair<size_t, frame_data> >::iterator > _cache_index;
+         mutable std::mutex                                                                      _mutex;
+   };
+
+} }
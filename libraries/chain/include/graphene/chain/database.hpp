@@ -30,11 +30,14 @@
 #include <graphene/chain/block_database.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/chain/evaluator.hpp>
+#include <graphene/chain/referral_path.hpp>
+#include <graphene/chain/state_gate.hpp>
 
 #include <graphene/db/object_database.hpp>
 #include <graphene/db/object.hpp>
 #include <graphene/db/simple_index.hpp>
 #include <fc/signals.hpp>
+#include <fc/thread/thread.hpp>
 
 #include <fc/log/logger.hpp>
 
@@ -47,6 +50,30 @@ namespace graphene { namespace chain {
    class transaction_evaluation_state;
 
    struct budget_record;
+   struct gr_rank_assignment;
+
+   /**
+    *  The objects created, modified and removed by the changes that were just applied, and the accounts they
+    *  impact. It is computed once and shared read only by all subscribers of database::object_changes.
+    *
+    *  The object pointers are aligned with the ids and are only valid while the signal is emitted: new and
+    *  changed objects point to their current state in the database, or are null if they no longer exist,
+    *  removed objects point to their last value.
+    */
+   struct object_change_set
+   {
+      vector<object_id_type>     new_ids;
+      vector<const object*>      new_objects;
+      flat_set<account_id_type>  new_accounts_impacted;
+
+      vector<object_id_type>     changed_ids;
+      vector<const object*>      changed_objects;
+      flat_set<account_id_type>  changed_accounts_impacted;
+
+      vector<object_id_type>     removed_ids;
+      vector<const object*>      removed_objects;
+      flat_set<account_id_type>  removed_accounts_impacted;
+   };
 
    /**
     *   @class database
@@ -156,6 +183,13 @@ namespace graphene { namespace chain {
          void pop_block();
          void clear_pending();
 
+         /**
+          *  Pops the blocks after the last irreversible block, calls @p f with the state of that block and applies
+          *  the popped blocks again. Used to export a state that cannot be orphaned. Throws if the undo history
+          *  does not reach back to the last irreversible block, e.g. right after the node was started.
+          */
+         void with_irreversible_state( const std::function<void()>& f );
+
          /**
           *  This method is used to track appied operations during the evaluation of a block, these
           *  operations should include any operation actually included in a transaction as well
@@ -204,6 +238,13 @@ namespace graphene { namespace chain {
           */
          fc::signal<void(const vector<object_id_type>&, const vector<const object*>&, const flat_set<account_id_type>&)>  removed_objects;
 
+         /**
+          *  Emitted after new_objects, changed_objects and removed_objects with all of their data in one set, so
+          *  that subscribers do not have to look the objects up again. The callback should not yield and should
+          *  execute quickly, but it may keep the set itself.
+          */
+         fc::signal<void(const std::shared_ptr<const object_change_set>&)> object_changes;
+
          //////////////////// db_witness_schedule.cpp ////////////////////
 
          /**
@@ -414,6 +455,40 @@ namespace graphene { namespace chain {
          /// Enable or disable tracking of votes of standby witnesses and committee members
          inline void enable_standby_votes_tracking(bool enable)  { _track_standby_votes = enable; }
 
+         /// Enable or disable serving block reads from memory mappings of the block log, see block_database
+         inline void enable_mapped_block_reads(bool enable)  { _block_id_to_block.enable_mapped_reads( enable ); }
+
+         /// Enable or disable writing new block logs as compressed frames, see block_database. Call before open().
+         inline void enable_block_log_compression(bool enable, uint32_t frame_size, uint32_t cached_frames)
+         { _block_id_to_block.enable_compression( enable, frame_size, cached_frames ); }
+
+         /// Enable or disable accumulating the vote tally of the maintenance interval on the worker thread pool
+         inline void enable_parallel_vote_tally(bool enable)  { _parallel_vote_tally = enable; }
+
+         /// Write the object database to disk every @p blocks blocks during a replay, so that it can be resumed
+         inline void set_replay_checkpoint_interval(uint32_t blocks)  { _replay_checkpoint_interval = blocks; }
+
+         /// Serve read_state() calls on @p threads dedicated threads, 0 to run them in place on the calling thread
+         void set_api_reader_threads( uint16_t threads );
+
+         /**
+          *  Runs @p f against the object database while blocks and transactions are kept from being applied.
+          *  With reader threads configured, f runs on one of them and only the calling fiber waits for it, so the
+          *  chain thread goes on receiving blocks and serving other requests; several readers run at the same time.
+          *  A block that arrives meanwhile waits for the reads in flight, see state_gate, so f should be bounded.
+          *  Without reader threads, or when called from inside another read, f runs in place.
+          *  f must not modify the database.
+          */
+         void read_state( const std::function<void()>& f )const;
+
+         /// Enable or disable timing of block stages and operations, logging a summary every @p log_interval blocks
+         inline void enable_profiling(bool enable, uint32_t log_interval)  { _profiler.enable( enable, log_interval ); }
+         inline block_profiler& get_profiler()  { return _profiler; }
+         inline const block_profiler& get_profiler()const  { return _profiler; }
+
+         /// @return the memo used by next_rewardable(), or nullptr if results must not be memoized right now
+         inline next_rewardable_memo* get_next_rewardable_memo() { return _next_rewardable_memo.get(); }
+
          /** Precomputes digests, signatures and operation validations depending
           *  on skip flags. "Expensive" computations may be done in a parallel
           *  thread.
@@ -433,6 +508,16 @@ namespace graphene { namespace chain {
           *         precomputations applied
           */
          fc::future<void> precompute_parallel( const precomputable_transaction& trx )const;
+
+         /** Screens incoming transactions before they are pushed. Precomputes a batch on the worker pool like
+          *  precompute_parallel(), splitting it into one task per pool thread, and rejects the transactions that
+          *  fail validation or signature key recovery. No state is read, push_transaction() does the duplicate,
+          *  authority, TaPoS and expiration checks. Batching thus only amortizes the precomputation.
+          *
+          * @param trxs the transactions to screen, they must outlive the call
+          * @return one entry per transaction: the reason for rejecting it, or an empty pointer
+          */
+         vector<fc::exception_ptr> screen_transactions( const vector<const precomputable_transaction*>& trxs )const;
    private:
          template<typename Trx>
          void _precompute_parallel( const Trx* trx, const size_t count, const uint32_t skip )const;
@@ -519,9 +604,9 @@ namespace graphene { namespace chain {
          void count_gr_votes();
          void proceed_gr_top3();
          void proceed_gr_bets();
-         void reset_gr_rank();
-         void assign_gr_rank_to_team(const gr_team_object& team_obj, const share_type& reward, const uint8_t& rank);
-         share_type assign_gr_rank(const share_type& start_itr, const share_type& end_itr, const share_type& reward, const uint8_t& rank);
+         void apply_gr_ranks(const gr_rank_assignment& ranks);
+         void assign_gr_rank_to_team(const gr_team_object& team_obj, const share_type& reward, const uint8_t& rank, gr_rank_assignment& ranks);
+         share_type assign_gr_rank(const share_type& start_itr, const share_type& end_itr, const share_type& reward, const uint8_t& rank, gr_rank_assignment& ranks);
          void proceed_gr_rank();
          void init_gr_race();
          void proceed_apostolos();
@@ -565,6 +650,9 @@ namespace graphene { namespace chain {
          vector<uint64_t>                  _committee_count_histogram_buffer;
          uint64_t                          _total_voting_stake;
 
+         /// Only installed while paying out pending fees in perform_account_maintenance()
+         std::unique_ptr<next_rewardable_memo> _next_rewardable_memo;
+
          flat_map<uint32_t,block_id_type>  _checkpoints;
 
          node_property_object              _node_property_object;
@@ -573,6 +661,21 @@ namespace graphene { namespace chain {
          /// Set it to true to provide accurate data to API clients, set to false to have better performance.
          bool                              _track_standby_votes = true;
 
+         /// Whether to accumulate the vote tally on the worker thread pool when performing chain maintenance.
+         /// The result is the same, only the votes of every account are summed up in per-thread buffers.
+         bool                              _parallel_vote_tally = false;
+
+         /// Number of blocks after which a replay writes the object database to disk, 0 disables checkpoints.
+         uint32_t                          _replay_checkpoint_interval = 0;
+
+         block_profiler                    _profiler;
+
+         /// Entered by read_state() on reader threads and, see detail::state_write_guard, by the methods that
+         /// modify the object database
+         mutable state_gate                          _state_gate;
+         vector<std::unique_ptr<fc::thread>>         _api_reader_threads;
+         mutable std::atomic<uint32_t>               _next_api_reader{ 0 };
+
          /**
           * Whether database is successfully opened or not.
           *
@@ -59,6 +59,27 @@ struct skip_flags_restorer
    uint32_t _old_skip_flags;      // initialized in ctor
 };
 
+/**
+ * Keeps read_state() calls on reader threads out while the database is being
+ * modified, so that they see no half applied block or transaction.  Waiting for
+ * the reads in flight only yields the calling fiber, see state_gate.
+ */
+struct state_write_guard
+{
+   state_write_guard( state_gate& gate )
+      : _gate( gate )
+   {
+      _gate.begin_write();
+   }
+
+   ~state_write_guard()
+   {
+      _gate.end_write();
+   }
+
+   state_gate& _gate;
+};
+
 /**
  * Class used to help the without_pending_transactions
  * implementation.
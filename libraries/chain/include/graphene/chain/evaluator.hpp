@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 #pragma once
+#include <graphene/chain/block_profiler.hpp>
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/transaction_evaluation_state.hpp>
 #include <graphene/chain/protocol/operations.hpp>
@@ -107,6 +108,7 @@ namespace graphene { namespace chain {
       // cause a circular dependency
       share_type calculate_fee_for_operation(const operation& op) const;
       void db_adjust_balance(const account_id_type& fee_payer, asset fee_from_account);
+      block_profiler& profiler()const;
 
       asset                            fee_from_account;
       share_type                       core_fee_paid;
@@ -156,7 +158,13 @@ namespace graphene { namespace chain {
                        ("core_fee_paid",core_fee_paid)("required", required_fee) );
          }
 
-         return eval->do_evaluate(op);
+         block_profiler& prof = profiler();
+         if( !prof.enabled() )
+            return eval->do_evaluate(op);
+         const uint64_t start = block_profiler::ticks();
+         auto result = eval->do_evaluate(op);
+         prof.record_operation( get_type(), block_profiler::phase_evaluate, start );
+         return result;
       }
 
       virtual operation_result apply(const operation& o) final override
@@ -167,7 +175,11 @@ namespace graphene { namespace chain {
          convert_fee();
          pay_fee();
 
+         block_profiler& prof = profiler();
+         const uint64_t start = prof.enabled() ? block_profiler::ticks() : 0;
          auto result = eval->do_apply(op);
+         if( prof.enabled() )
+            prof.record_operation( get_type(), block_profiler::phase_apply, start );
 
          db_adjust_balance(op.fee_payer(), -fee_from_account);
 
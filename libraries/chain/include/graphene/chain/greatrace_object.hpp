@@ -12,6 +12,7 @@
 #include <graphene/db/object.hpp>
 #include <graphene/db/generic_index.hpp>
 #include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/ranked_index.hpp>
 
 namespace graphene { namespace chain {
 	using namespace graphene::db;
@@ -54,69 +55,70 @@ namespace graphene { namespace chain {
 	struct by_name;
 	struct by_captain;
 
+	// volume indices are ranked, so the place of a team in a rating is found in logarithmic time
 	typedef multi_index_container<
 		gr_team_object,
 		indexed_by<
 		ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
 		ordered_unique<tag<by_name>, member<gr_team_object, string, &gr_team_object::name>>,
 		ordered_unique<tag<by_captain>, member<gr_team_object, account_id_type, &gr_team_object::captain>>,
-		ordered_unique<tag<by_gr_interval_2_volume>,
+		ranked_unique<tag<by_gr_interval_2_volume>,
 			composite_key<
 				gr_team_object,
 				member<gr_team_object, share_type, &gr_team_object::gr_interval_2_volume>,
 				member< object, object_id_type, &object::id>
 			>
 		 >,
-		ordered_unique<tag<by_gr_interval_4_volume>,
+		ranked_unique<tag<by_gr_interval_4_volume>,
 			composite_key<
 				gr_team_object,
 				member<gr_team_object, share_type, &gr_team_object::gr_interval_4_volume>,
 				member< object, object_id_type, &object::id>
 			>
 		 >,
-		ordered_unique<tag<by_gr_interval_6_volume>,
+		ranked_unique<tag<by_gr_interval_6_volume>,
 			composite_key<
 				gr_team_object,
 				member<gr_team_object, share_type, &gr_team_object::gr_interval_6_volume>,
 				member< object, object_id_type, &object::id>
 			>
 		 >,
-		ordered_unique<tag<by_gr_interval_9_volume>,
+		ranked_unique<tag<by_gr_interval_9_volume>,
 			composite_key<
 				gr_team_object,
 				member<gr_team_object, share_type, &gr_team_object::gr_interval_9_volume>,
 				member< object, object_id_type, &object::id>
 			>
 		 >,
-		ordered_unique<tag<by_gr_interval_11_volume>,
+		ranked_unique<tag<by_gr_interval_11_volume>,
 			composite_key<
 				gr_team_object,
 				member<gr_team_object, share_type, &gr_team_object::gr_interval_11_volume>,
 				member< object, object_id_type, &object::id>
 			>
 		 >,
-		ordered_unique<tag<by_gr_interval_13_volume>,
+		ranked_unique<tag<by_gr_interval_13_volume>,
 			composite_key<
 				gr_team_object,
 				member<gr_team_object, share_type, &gr_team_object::gr_interval_13_volume>,
 				member< object, object_id_type, &object::id>
 			>
 		 >,
-		ordered_unique<tag<by_total_first_half_volume>,
+		ranked_unique<tag<by_total_first_half_volume>,
 			composite_key<
 				gr_team_object,
 				member<gr_team_object, share_type, &gr_team_object::first_half_volume>,
 				member< object, object_id_type, &object::id>
 			>
 		 >,
-		ordered_unique<tag<by_total_second_half_volume>,
+		ranked_unique<tag<by_total_second_half_volume>,
 			composite_key<
 				gr_team_object,
 				member<gr_team_object, share_type, &gr_team_object::second_half_volume>,
 				member< object, object_id_type, &object::id>
 			>
 		 >,
-		ordered_unique<tag<by_total_volume>,
+		ranked_unique<tag<by_total_volume>,
 			composite_key<
 				gr_team_object,
 				member<gr_team_object, share_type, &gr_team_object::total_volume>,
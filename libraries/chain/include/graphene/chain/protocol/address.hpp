@@ -28,6 +28,7 @@
 
 #include <fc/array.hpp>
 #include <fc/crypto/ripemd160.hpp>
+#include <fc/io/json_writer_fwd.hpp>
 
 namespace fc { namespace ecc {
     class public_key;
@@ -80,6 +81,8 @@ namespace fc
 {
    void to_variant( const graphene::chain::address& var,  fc::variant& vo, uint32_t max_depth = 1 );
    void from_variant( const fc::variant& var,  graphene::chain::address& vo, uint32_t max_depth = 1 );
+
+   template<> struct json_use_variant<graphene::chain::address> : std::true_type {};
 }
 
 namespace std
@@ -24,6 +24,7 @@
 #pragma once
 #include <fc/container/flat_fwd.hpp>
 #include <fc/io/varint.hpp>
+#include <fc/io/json_writer_fwd.hpp>
 #include <fc/io/enum_type.hpp>
 #include <fc/crypto/sha224.hpp>
 #include <fc/crypto/elliptic.hpp>
@@ -373,6 +374,10 @@ namespace fc
     void from_variant( const fc::variant& var, graphene::chain::extended_public_key_type& vo, uint32_t max_depth = 2 );
     void to_variant( const graphene::chain::extended_private_key_type& var, fc::variant& vo, uint32_t max_depth = 2 );
     void from_variant( const fc::variant& var, graphene::chain::extended_private_key_type& vo, uint32_t max_depth = 2 );
+
+    template<> struct json_use_variant<graphene::chain::public_key_type> : std::true_type {};
+    template<> struct json_use_variant<graphene::chain::extended_public_key_type> : std::true_type {};
+    template<> struct json_use_variant<graphene::chain::extended_private_key_type> : std::true_type {};
 }
 
 FC_REFLECT( graphene::chain::public_key_type, (key_data) )
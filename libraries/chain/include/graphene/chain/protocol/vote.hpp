@@ -29,6 +29,7 @@
 #include <string>
 
 #include <fc/container/flat.hpp>
+#include <fc/io/json_writer_fwd.hpp>
 #include <fc/reflect/reflect.hpp>
 
 namespace graphene { namespace chain {
@@ -144,6 +145,8 @@ class variant;
 void to_variant( const graphene::chain::vote_id_type& var, fc::variant& vo, uint32_t max_depth = 1 );
 void from_variant( const fc::variant& var, graphene::chain::vote_id_type& vo, uint32_t max_depth = 1 );
 
+template<> struct json_use_variant<graphene::chain::vote_id_type> : std::true_type {};
+
 } // fc
 
 FC_REFLECT_TYPENAME( fc::flat_set<graphene::chain::vote_id_type> )
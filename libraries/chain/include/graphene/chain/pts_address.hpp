@@ -24,6 +24,7 @@
 #pragma once
 
 #include <fc/array.hpp>
+#include <fc/io/json_writer_fwd.hpp>
 #include <string>
 
 namespace fc { namespace ecc { class public_key; } }
@@ -75,4 +76,6 @@ namespace fc
 { 
    void to_variant( const graphene::chain::pts_address& var,  fc::variant& vo, uint32_t max_depth = 1 );
    void from_variant( const fc::variant& var,  graphene::chain::pts_address& vo, uint32_t max_depth = 1 );
+
+   template<> struct json_use_variant<graphene::chain::pts_address> : std::true_type {};
 }
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/types.hpp>
+
+namespace graphene { namespace chain {
+
+class account_object;
+class database;
+
+/**
+ * @brief Returns the closest ancestor of @p a in the referral tree that is eligible for referral rewards
+ *
+ * Compressed accounts (no active status, or an active status below @ref chain_parameters::min_not_compressed
+ * with personal volume not exceeding @ref chain_parameters::compression_limit) are skipped, up to
+ * @ref chain_parameters::compression_levels hops. The chain is walked by reference, no account is copied.
+ *
+ * If the database has a @ref next_rewardable_memo installed, the result is looked up there first and
+ * stored there afterwards.
+ */
+account_id_type next_rewardable( const account_object& a, database& d );
+
+/**
+ * @brief Remembers the results of @ref next_rewardable by account instance
+ *
+ * The result of @ref next_rewardable depends on referrers, referral statuses, personal volumes, the head
+ * block time and the chain parameters. None of them can change while pending fees are paid out in
+ * @ref database::perform_account_maintenance, so the memo is only installed for the duration of that loop.
+ */
+class next_rewardable_memo
+{
+   public:
+      /// @param accounts expected number of accounts, used to size the memo up front
+      explicit next_rewardable_memo( size_t accounts = 0 ) : _next( accounts, unknown() ) {}
+
+      /// @return true and sets @p next if the result for @p a is known
+      bool find( account_id_type a, account_id_type& next )const
+      {
+         const uint64_t instance = a.instance.value;
+         if( instance >= _next.size() || _next[instance] == unknown() )
+            return false;
+         next = account_id_type( _next[instance] );
+         return true;
+      }
+
+      void store( account_id_type a, account_id_type next )
+      {
+         const uint64_t instance = a.instance.value;
+         if( instance >= _next.size() )
+            _next.resize( instance + 1, unknown() );
+         _next[instance] = next.instance.value;
+      }
+
+   private:
+      static uint64_t unknown() { return std::numeric_limits<uint64_t>::max(); }
+
+      /// account instance => instance of the next rewardable account, or @ref unknown
+      vector<uint64_t> _next;
+};
+
+} } // graphene::chain
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+#include <fc/thread/future.hpp>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  Keeps read_state() calls on reader threads and the writes of the chain thread apart.
+    *
+    *  Writers only run on the chain thread. A writer that finds reads in flight yields its fiber on an fc future
+    *  until they are done, so the other fibers of the chain thread, p2p included, keep running. Reads that arrive
+    *  while a write is waiting or in progress block their reader thread until the last write is done, which bounds
+    *  the wait of a writer by the longest read in flight.
+    *
+    *  Writes nest, and fibers of the chain thread that write while another one waits for the readers also wait,
+    *  so no write starts before the readers are gone.
+    */
+   class state_gate
+   {
+      public:
+         /// Called on the chain thread before the object database is modified
+         void begin_write();
+         void end_write();
+
+         /// Called on a reader thread around a read of the object database
+         void begin_read();
+         void end_read();
+
+      private:
+         std::mutex                _mutex;
+         std::condition_variable   _writes_done;
+         uint32_t                  _writes = 0;
+         uint32_t                  _reads = 0;
+         /// Set while writers wait for the reads in flight
+         fc::promise<void>::ptr    _reads_done;
+   };
+
+} }
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/referral_path.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/database.hpp>
+
+namespace graphene { namespace chain {
+
+account_id_type next_rewardable( const account_object& a, database& d )
+{
+   reward_log( "Called next_rewardable with account ${acc}", ("acc",a.name));
+   const auto& params = d.get_global_properties().parameters;
+   if( a.get_id() < params.root_account || a.get_id() == params.root_account )
+   {
+      reward_log( "next_rewardable Return Root");
+      return params.root_account;
+   }
+   if( !params.compression )
+   {
+      reward_log( "next_rewardable Return WO Compression ${acc}", ("acc",a.referrer));
+      return a.referrer;
+   }
+
+   next_rewardable_memo* memo = d.get_next_rewardable_memo();
+   account_id_type result;
+   if( memo != nullptr && memo->find( a.get_id(), result ) )
+      return result;
+
+   const time_point_sec now = d.head_block_time();
+   const account_object* ref = &a;
+   uint8_t current_compression = 0;
+   bool compressed;
+   do
+   {
+      ref = &d.get( ref->referrer );
+      current_compression++;
+      reward_log( "next_rewardable:do_while account ${acc}, compression level ${level}, PV ${pv}, PVCL ${pvcl}", ("acc",ref->name)("level",current_compression)("pv",ref->statistics(d).get_pv(d))("pvcl",params.compression_limit));
+
+      compressed = false;
+      if( current_compression <= params.compression_levels && ref->get_id() > params.root_account )
+      {
+         const uint8_t status = ref->active_referral_status( now );
+         compressed = ( status == 0 ) ||
+                      ( status < params.min_not_compressed && ref->statistics(d).get_pv(d) <= params.compression_limit );
+      }
+   } while( compressed );
+
+   reward_log( "next_rewardable Return ${acc}", ("acc",ref->name));
+   result = ( ref->get_id() < params.root_account ) ? params.root_account : ref->get_id();
+   if( memo != nullptr )
+      memo->store( a.get_id(), result );
+   return result;
+}
+
+} } // graphene::chain
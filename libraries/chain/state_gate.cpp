@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/state_gate.hpp>
+
+namespace graphene { namespace chain {
+
+void state_gate::begin_write()
+{
+   fc::future<void> reads_done;
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      ++_writes;
+      if( _reads == 0 )
+         return;
+      if( !_reads_done )
+         _reads_done.reset( new fc::promise<void>( "state_gate::reads_done" ) );
+      reads_done = fc::future<void>( _reads_done );
+   }
+   try
+   {
+      reads_done.wait();
+   }
+   catch( ... )
+   {
+      end_write();
+      throw;
+   }
+}
+
+void state_gate::end_write()
+{
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      if( --_writes > 0 )
+         return;
+   }
+   _writes_done.notify_all();
+}
+
+void state_gate::begin_read()
+{
+   std::unique_lock<std::mutex> lock( _mutex );
+   _writes_done.wait( lock, [this] () { return _writes == 0; } );
+   ++_reads;
+}
+
+void state_gate::end_read()
+{
+   fc::promise<void>::ptr reads_done;
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      if( --_reads == 0 )
+         reads_done = std::move( _reads_done );
+   }
+   if( reads_done )
+      reads_done->set_value();
+}
+
+} }
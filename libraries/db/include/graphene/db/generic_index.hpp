@@ -88,6 +88,13 @@ namespace graphene { namespace chain {
             FC_ASSERT(ok, "Could not modify object, most likely an index constraint was violated");
          }
 
+         /// Moves obj to its new position in all indices after it was changed in place
+         void reindex( const object& obj )
+         {
+            auto ok = _indices.modify( _indices.iterator_to( static_cast<const ObjectType&>(obj) ), []( ObjectType& ){} );
+            FC_ASSERT( ok, "Could not modify object, most likely an index constraint was violated" );
+         }
+
          virtual void remove( const object& obj )override
          {
             _indices.erase( _indices.iterator_to( static_cast<const ObjectType&>(obj) ) );
@@ -102,7 +109,7 @@ namespace graphene { namespace chain {
             return &*itr;
          }
 
-         virtual void inspect_all_objects(std::function<void (const object&)> inspector)const override
+         virtual void inspect_all_objects(const std::function<void (const object&)>& inspector)const override
          {
             try {
                for( const auto& ptr : _indices )
@@ -28,6 +28,7 @@
 #include <fc/io/raw.hpp>
 #include <fc/io/json.hpp>
 #include <fc/crypto/sha256.hpp>
+#include <fc/crypto/city.hpp>
 
 #include <fstream>
 #include <stack>
@@ -52,6 +53,47 @@ namespace graphene { namespace db {
          virtual void on_modify( const object& obj ){}
    };
 
+   /**
+    *  @class dense_id_table
+    *  @brief Maps the instance numbers of one object type to its objects, in chunks of 2^chunk_bits pointers
+    *
+    *  Lookups are O(1) and touch a single chunk. A chunk is allocated when the first object of its range is
+    *  added, so ids that were removed or never used only cost the pointers of their chunk.
+    */
+   class dense_id_table
+   {
+      public:
+         explicit dense_id_table( uint8_t chunk_bits )
+            :_chunk_bits( chunk_bits ),_mask( (uint64_t(1) << chunk_bits) - 1 ) {}
+
+         const object* find( uint64_t instance )const
+         {
+            const uint64_t chunk = instance >> _chunk_bits;
+            if( chunk >= _chunks.size() || !_chunks[chunk] ) return nullptr;
+            return _chunks[chunk][instance & _mask];
+         }
+
+         void set( uint64_t instance, const object* obj )
+         {
+            const uint64_t chunk = instance >> _chunk_bits;
+            if( chunk >= _chunks.size() ) _chunks.resize( chunk + 1 );
+            if( !_chunks[chunk] ) _chunks[chunk].reset( new const object*[_mask + 1]() );
+            _chunks[chunk][instance & _mask] = obj;
+         }
+
+         void clear( uint64_t instance )
+         {
+            const uint64_t chunk = instance >> _chunk_bits;
+            if( chunk < _chunks.size() && _chunks[chunk] )
+               _chunks[chunk][instance & _mask] = nullptr;
+         }
+
+      private:
+         const uint8_t                          _chunk_bits;
+         const uint64_t                         _mask;
+         vector< unique_ptr<const object*[]> >  _chunks;
+   };
+
    /**
     *  @class index
     *  @brief abstract base class for accessing objects indexed in various ways.
@@ -80,6 +122,9 @@ namespace graphene { namespace db {
          virtual void           use_next_id() = 0;
          virtual void           set_next_id( object_id_type id ) = 0;
 
+         /** @return a counter that changes whenever objects are created, modified or removed, or the next id changes */
+         virtual uint64_t       get_generation()const = 0;
+
          virtual const object&  load( const std::vector<char>& data ) = 0;
          /**
           *  Polymorphically insert by moving an object into the index.
@@ -119,22 +164,56 @@ namespace graphene { namespace db {
          virtual void               remove( const object& obj ) = 0;
 
          /**
-          *   When forming your lambda to modify obj, it is natural to have Object& be the signature, but
-          *   that is not compatible with the type erasue required by the virtual method.  This method
-          *   provides a helper to wrap the lambda in a form compatible with the virtual modify call.
+          *  Applies m to each of objs, which must all belong to this index. Primary indexes override this to record
+          *  the undo state of the whole batch at once.
+          */
+         virtual void               modify_batch( const vector<const object*>& objs, const std::function<void(object&)>& m )
+         {
+            for( const object* obj : objs )
+               modify( *obj, m );
+         }
+
+         /**
+          *  Changing an object in place: begin_modify records the undo state of obj and tells the secondary
+          *  indexes, then the caller changes obj itself, then end_modify moves obj to its new position in the
+          *  index and tells everyone about the change. end_modify must be called even if changing obj failed.
+          */
+         virtual void               begin_modify( const object& obj ) = 0;
+         virtual void               end_modify( const object& obj ) = 0;
+
+         /**
+          *   Applies l to obj in place, between begin_modify and end_modify, so that l is called directly
+          *   instead of through the std::function of the virtual modify call.
           *   @note Lambda should have the signature:  void(Object&)
           */
          template<typename Object, typename Lambda>
          void modify( const Object& obj, const Lambda& l ) {
-            modify( static_cast<const object&>(obj), std::function<void(object&)>( [&]( object& o ){ l( static_cast<Object&>(o) ); } ) );
+            begin_modify( obj );
+            try
+            {
+               l( const_cast<Object&>( obj ) );
+            }
+            catch( ... )
+            {
+               elog( "Exception while modifying object ${id} -- object may be corrupted", ("id",obj.id) );
+               end_modify( obj );
+               throw;
+            }
+            end_modify( obj );
          }
 
-         virtual void               inspect_all_objects(std::function<void(const object&)> inspector)const = 0;
+         virtual void               inspect_all_objects(const std::function<void(const object&)>& inspector)const = 0;
          virtual fc::uint128        hash()const = 0;
          virtual void               add_observer( const shared_ptr<index_observer>& ) = 0;
 
          virtual void               object_from_variant( const fc::variant& var, object& obj, uint32_t max_depth )const = 0;
          virtual void               object_default( object& obj )const = 0;
+
+         /** @return the table of the objects by instance, or nullptr if this index does not keep one */
+         const dense_id_table*      dense_ids()const { return _dense_ids; }
+
+      protected:
+         const dense_id_table*      _dense_ids = nullptr;
    };
 
    class secondary_index
@@ -157,6 +236,8 @@ namespace graphene { namespace db {
 
          /** called just before obj is modified */
          void save_undo( const object& obj );
+         /** called just before all of objs are modified */
+         void save_undo( const vector<const object*>& objs );
 
          /** called just after the object is added */
          void on_add( const object& obj );
@@ -186,6 +267,13 @@ namespace graphene { namespace db {
          }
 
       protected:
+         /**
+          *  Runs produce( 0 ) ... produce( tasks - 1 ) on the worker pool, a few of them at a time, and passes their
+          *  results to consume in order. A single task is run on the calling thread.
+          */
+         static void run_ordered( size_t tasks, const std::function<shared_ptr<void>(size_t)>& produce,
+                                  const std::function<void(const shared_ptr<void>&)>& consume );
+
          vector< shared_ptr<index_observer> >   _observers;
          vector< unique_ptr<secondary_index> >  _sindex;
 
@@ -304,6 +392,10 @@ namespace graphene { namespace db {
     * @brief  Wraps a derived index to intercept calls to create, modify, and remove so that
     *  callbacks may be fired and undo state saved.
     *
+    *  With DirectBits > 0 the index also keeps a dense_id_table of its objects, in chunks of 2^DirectBits,
+    *  which makes lookups by id O(1). This is meant for object types that are looked up by id a lot and whose
+    *  ids are mostly in use; the objects themselves stay in DerivedIndex.
+    *
     *  @see http://en.wikipedia.org/wiki/Curiously_recurring_template_pattern
     */
    template<typename DerivedIndex, uint8_t DirectBits = 0>
@@ -313,10 +405,11 @@ namespace graphene { namespace db {
          typedef typename DerivedIndex::object_type object_type;
 
          primary_index( object_database& db )
-         :base_primary_index(db),_next_id(object_type::space_id,object_type::type_id,0)
+         :base_primary_index(db),_next_id(object_type::space_id,object_type::type_id,0),_by_instance(DirectBits)
          {
+            static_assert( DirectBits < 32, "Chunks of more than 2^31 objects are not supported" );
             if( DirectBits > 0 )
-               _direct_by_id = add_secondary_index< direct_index< object_type, DirectBits > >();
+               this->_dense_ids = &_by_instance;
          }
 
          virtual uint8_t object_space_id()const override
@@ -326,14 +419,18 @@ namespace graphene { namespace db {
          { return object_type::type_id; }
 
          virtual object_id_type get_next_id()const override              { return _next_id;    }
-         virtual void           use_next_id()override                    { ++_next_id.number;  }
-         virtual void           set_next_id( object_id_type id )override { _next_id = id;      }
+         virtual void           use_next_id()override                    { ++_next_id.number; ++_generation; }
+         virtual void           set_next_id( object_id_type id )override { _next_id = id; ++_generation; }
+         virtual uint64_t       get_generation()const override           { return _generation; }
 
          /** @return the object with id or nullptr if not found */
          virtual const object*  find( object_id_type id )const override
          {
             if( DirectBits > 0 )
-               return _direct_by_id->find( id );
+            {
+               assert( id.space() == object_type::space_id && id.type() == object_type::type_id );
+               return _by_instance.find( id.instance() );
+            }
             return DerivedIndex::find( id );
          }
 
@@ -343,6 +440,15 @@ namespace graphene { namespace db {
             return fc::sha256::hash(desc);
          }
 
+         /**
+          *  The file starts with the next id, the object version and the number of objects, followed by
+          *  chunks of packed objects. Every chunk is preceded by its object count, its size in bytes and
+          *  a checksum of its bytes. The checksums of all chunks are verified before the first object is
+          *  inserted, so that a damaged file is rejected instead of being loaded partially.
+          *
+          *  Objects are unpacked straight from the mapped file. Big files are verified and unpacked by several
+          *  workers, a few chunks each, and the objects are still inserted in the order of the file.
+          */
          virtual void open( const path& db )override
          { 
             if( !fc::exists( db ) ) return;
@@ -350,45 +456,105 @@ namespace graphene { namespace db {
             fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size(db) );
             fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
             fc::sha256 open_ver;
+            uint64_t object_count;
 
             fc::raw::unpack(ds, _next_id);
             fc::raw::unpack(ds, open_ver);
             FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
-            vector<char> tmp;
+            fc::raw::unpack(ds, object_count);
+
+            vector<file_chunk> chunks;
+            uint64_t found = 0;
             while( ds.remaining() > 0 )
             {
-               fc::raw::unpack( ds, tmp );
-               load( tmp );
+               file_chunk chunk;
+               fc::raw::unpack( ds, chunk.objects );
+               fc::raw::unpack( ds, chunk.size );
+               fc::raw::unpack( ds, chunk.checksum );
+               FC_ASSERT( ds.remaining() >= chunk.size, "Truncated chunk in ${db}", ("db",db) );
+               chunk.data = ds.pos();
+               chunks.push_back( chunk );
+               ds.skip( chunk.size );
+               found += chunk.objects;
             }
+            FC_ASSERT( found == object_count, "Expected ${n} objects in ${db} but found ${found}",
+                       ("n",object_count)("db",db)("found",found) );
+
+            const size_t chunks_per_task = 4;
+            const size_t tasks = ( chunks.size() + chunks_per_task - 1 ) / chunks_per_task;
+            run_ordered( tasks, [&chunks,&db,chunks_per_task]( size_t task ) {
+               const size_t first = task * chunks_per_task;
+               const size_t last = std::min( first + chunks_per_task, chunks.size() );
+               for( size_t i = first; i < last; ++i )
+                  FC_ASSERT( fc::city_hash64( chunks[i].data, chunks[i].size ) == chunks[i].checksum,
+                             "Checksum mismatch in ${db}", ("db",db) );
+               return shared_ptr<void>();
+            }, []( const shared_ptr<void>& ) {} );
+            run_ordered( tasks, [&chunks,chunks_per_task]( size_t task ) {
+               const size_t first = task * chunks_per_task;
+               const size_t last = std::min( first + chunks_per_task, chunks.size() );
+               return shared_ptr<void>( unpack_chunks( chunks.data() + first, chunks.data() + last ) );
+            }, [this]( const shared_ptr<void>& result ) {
+               for( auto& obj : *std::static_pointer_cast< vector<object_type> >( result ) )
+                  load_object( std::move( obj ) );
+            });
          }
 
+         /** Big indexes are packed by several workers, each into the chunks of a contiguous range of objects */
          virtual void save( const path& db ) override 
          {
+            vector<const object_type*> objs;
+            this->inspect_all_objects( [&objs]( const object& o ) {
+               objs.push_back( static_cast<const object_type*>( &o ) );
+            });
+
             std::ofstream out( db.generic_string(), 
                                std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
             FC_ASSERT( out );
             auto ver  = get_object_version();
             fc::raw::pack( out, _next_id );
             fc::raw::pack( out, ver );
-            this->inspect_all_objects( [&]( const object& o ) {
-                auto vec = fc::raw::pack( static_cast<const object_type&>(o) );
-                auto packed_vec = fc::raw::pack( vec );
-                out.write( packed_vec.data(), packed_vec.size() );
-            });
+            fc::raw::pack( out, uint64_t( objs.size() ) );
+
+            auto write_chunk = [&out]( const packed_chunk& chunk ) {
+               fc::raw::pack( out, chunk.objects );
+               fc::raw::pack( out, chunk.size );
+               fc::raw::pack( out, chunk.checksum );
+               out.write( chunk.data.get(), chunk.size );
+            };
+            const size_t objects_per_task = 64 * 1024;
+            if( objs.size() <= objects_per_task )
+               pack_objects( objs.data(), objs.data() + objs.size(), write_chunk );
+            else
+               run_ordered( ( objs.size() + objects_per_task - 1 ) / objects_per_task,
+                            [&objs,objects_per_task]( size_t task ) {
+                  const size_t first = task * objects_per_task;
+                  const size_t last = std::min( first + objects_per_task, objs.size() );
+                  auto chunks = std::make_shared< vector<packed_chunk> >();
+                  pack_objects( objs.data() + first, objs.data() + last, [&chunks]( packed_chunk& chunk ) {
+                     chunks->push_back( std::move( chunk ) );
+                  });
+                  return shared_ptr<void>( chunks );
+               }, [&write_chunk]( const shared_ptr<void>& result ) {
+                  for( const auto& chunk : *std::static_pointer_cast< vector<packed_chunk> >( result ) )
+                     write_chunk( chunk );
+               });
+            out.flush();
+            FC_ASSERT( out, "Unable to write ${db}", ("db",db) );
          }
 
          virtual const object&  load( const std::vector<char>& data )override
          {
-            const auto& result = DerivedIndex::insert( fc::raw::unpack<object_type>( data ) );
-            for( const auto& item : _sindex )
-               item->object_inserted( result );
-            return result;
+            return load_object( fc::raw::unpack<object_type>( data ) );
          }
 
 
          virtual const object&  create(const std::function<void(object&)>& constructor )override
          {
             const auto& result = DerivedIndex::create( constructor );
+            ++_generation;
+            if( DirectBits > 0 )
+               _by_instance.set( result.id.instance(), &result );
             for( const auto& item : _sindex )
                item->object_inserted( result );
             on_add( result );
@@ -398,6 +564,9 @@ namespace graphene { namespace db {
          virtual const object& insert( object&& obj ) override
          {
             const auto& result = DerivedIndex::insert( std::move( obj ) );
+            ++_generation;
+            if( DirectBits > 0 )
+               _by_instance.set( result.id.instance(), &result );
             for( const auto& item : _sindex )
                item->object_inserted( result );
             on_add( result );
@@ -409,20 +578,67 @@ namespace graphene { namespace db {
             for( const auto& item : _sindex )
                item->object_removed( obj );
             on_remove(obj);
+            if( DirectBits > 0 )
+               _by_instance.clear( obj.id.instance() );
             DerivedIndex::remove(obj);
+            ++_generation;
          }
 
          virtual void modify( const object& obj, const std::function<void(object&)>& m )override
          {
             save_undo( obj );
+            const object_id_type id = obj.id;
             for( const auto& item : _sindex )
                item->about_to_modify( obj );
             DerivedIndex::modify( obj, m );
+            ++_generation;
+            FC_ASSERT( DirectBits == 0 || obj.id == id, "Modification of ID is not supported!" );
             for( const auto& item : _sindex )
                item->object_modified( obj );
             on_modify( obj );
          }
 
+         virtual void begin_modify( const object& obj )override
+         {
+            save_undo( obj );
+            for( const auto& item : _sindex )
+               item->about_to_modify( obj );
+         }
+
+         virtual void end_modify( const object& obj )override
+         {
+            DerivedIndex::reindex( obj );
+            ++_generation;
+            FC_ASSERT( DirectBits == 0 || _by_instance.find( obj.id.instance() ) == &obj,
+                       "Modification of ID is not supported!" );
+            for( const auto& item : _sindex )
+               item->object_modified( obj );
+            on_modify( obj );
+         }
+
+         /**
+          *  Secondary indexes are still notified around each single change, since they may keep the state of the
+          *  object between about_to_modify and object_modified.
+          */
+         virtual void modify_batch( const vector<const object*>& objs, const std::function<void(object&)>& m )override
+         {
+            if( objs.empty() )
+               return;
+            save_undo( objs );
+            ++_generation;
+            for( const object* obj : objs )
+            {
+               const object_id_type id = obj->id;
+               for( const auto& item : _sindex )
+                  item->about_to_modify( *obj );
+               DerivedIndex::modify( *obj, m );
+               FC_ASSERT( DirectBits == 0 || obj->id == id, "Modification of ID is not supported!" );
+               for( const auto& item : _sindex )
+                  item->object_modified( *obj );
+               on_modify( *obj );
+            }
+         }
+
          virtual void add_observer( const shared_ptr<index_observer>& o ) override
          {
             _observers.emplace_back( o );
@@ -447,8 +663,106 @@ namespace graphene { namespace db {
          }
 
       private:
-         object_id_type                                 _next_id;
-         const direct_index< object_type, DirectBits >* _direct_by_id = nullptr;
+         /// A chunk of packed objects in a mapped file
+         struct file_chunk
+         {
+            const char* data = nullptr;
+            uint32_t    objects = 0;
+            uint32_t    size = 0;
+            uint64_t    checksum = 0;
+         };
+
+         /// A chunk of packed objects to be written, the buffer is not initialized beyond size
+         struct packed_chunk
+         {
+            std::unique_ptr<char[]> data;
+            size_t                  capacity = 0;
+            uint32_t                size = 0;
+            uint32_t                objects = 0;
+            uint64_t                checksum = 0;
+         };
+
+         static std::shared_ptr< vector<object_type> > unpack_chunks( const file_chunk* first, const file_chunk* last )
+         {
+            auto result = std::make_shared< vector<object_type> >();
+            uint64_t objects = 0;
+            for( const file_chunk* chunk = first; chunk != last; ++chunk )
+               objects += chunk->objects;
+            result->reserve( objects );
+            for( ; first != last; ++first )
+            {
+               fc::datastream<const char*> ds( first->data, first->size );
+               for( uint32_t i = 0; i < first->objects; ++i )
+               {
+                  result->emplace_back();
+                  fc::raw::unpack( ds, result->back() );
+               }
+            }
+            return result;
+         }
+
+         /**
+          *  Packs every object once, into the free space of the current chunk, and passes every full chunk to
+          *  emit. The free space is at least chunk_bytes, only bigger objects have to be measured and packed
+          *  again. The buffer of a chunk is reused unless emit takes it.
+          */
+         static void pack_objects( const object_type* const* first, const object_type* const* last,
+                                   const std::function<void(packed_chunk&)>& emit )
+         {
+            const size_t chunk_bytes = 1024 * 1024;
+            packed_chunk chunk;
+            auto finish_chunk = [&]() {
+               chunk.checksum = fc::city_hash64( chunk.data.get(), chunk.size );
+               emit( chunk );
+               chunk.size = 0;
+               chunk.objects = 0;
+            };
+            for( ; first != last; ++first )
+            {
+               if( !chunk.data )
+               {
+                  chunk.capacity = 2 * chunk_bytes;
+                  chunk.data.reset( new char[chunk.capacity] );
+               }
+               try
+               {
+                  fc::datastream<char*> ds( chunk.data.get() + chunk.size, chunk.capacity - chunk.size );
+                  fc::raw::pack( ds, **first );
+                  chunk.size += ds.tellp();
+               }
+               catch( const fc::out_of_range_exception& )
+               {
+                  const size_t size = fc::raw::pack_size( **first );
+                  std::unique_ptr<char[]> bigger( new char[chunk.size + size] );
+                  memcpy( bigger.get(), chunk.data.get(), chunk.size );
+                  chunk.data = std::move( bigger );
+                  chunk.capacity = chunk.size + size;
+                  fc::datastream<char*> ds( chunk.data.get() + chunk.size, size );
+                  fc::raw::pack( ds, **first );
+                  chunk.size += size;
+               }
+               ++chunk.objects;
+               if( chunk.size >= chunk_bytes )
+                  finish_chunk();
+            }
+            if( chunk.objects > 0 )
+               finish_chunk();
+         }
+
+         /// Inserts an object that was read from disk, loading does not count as a change of the index
+         const object& load_object( object_type&& obj )
+         {
+            const auto& result = DerivedIndex::insert( std::move( obj ) );
+            if( DirectBits > 0 )
+               _by_instance.set( result.id.instance(), &result );
+            for( const auto& item : _sindex )
+               item->object_inserted( result );
+            return result;
+         }
+
+         object_id_type   _next_id;
+         uint64_t         _generation = 0;
+         dense_id_table   _by_instance;
    };
 
 } } // graphene::db
@@ -74,6 +74,10 @@ namespace graphene { namespace db {
 
          /// these methods are implemented for derived classes by inheriting abstract_object<DerivedClass>
          virtual unique_ptr<object> clone()const = 0;
+         /// size of the most derived object, i.e. the storage needed by clone_into()
+         virtual size_t             object_size()const = 0;
+         /// copy constructs the most derived object into storage of at least object_size() bytes
+         virtual object*            clone_into( void* storage )const = 0;
          virtual void               move_from( object& obj ) = 0;
          virtual variant            to_variant()const  = 0;
          virtual vector<char>       pack()const = 0;
@@ -95,6 +99,11 @@ namespace graphene { namespace db {
          {
             return unique_ptr<object>(new DerivedClass( *static_cast<const DerivedClass*>(this) ));
          }
+         virtual size_t  object_size()const { return sizeof(DerivedClass); }
+         virtual object* clone_into( void* storage )const
+         {
+            return new (storage) DerivedClass( *static_cast<const DerivedClass*>(this) );
+         }
 
          virtual void    move_from( object& obj )
          {
@@ -42,26 +42,30 @@ namespace graphene { namespace db {
          object_database();
          ~object_database();
 
-         void reset_indexes() { _index.clear(); _index.resize(255); }
+         void reset_indexes() { _index.clear(); _index.resize(255); _flushed_generations.clear(); }
 
          void open(const fc::path& data_dir );
 
          /**
-          * Saves the complete state of the object_database to disk, this could take a while
+          * Saves the complete state of the object_database to disk, this could take a while. Indexes that
+          * did not change since they were last opened or flushed are hard-linked from the previous state.
           */
          void flush();
          void wipe(const fc::path& data_dir); // remove from disk
          void close();
 
+         /// Builds the object here and moves it into its index, which does the same as index::create() without
+         /// passing constructor through a std::function
          template<typename T, typename F>
          const T& create( F&& constructor )
          {
             auto& idx = get_mutable_index<T>();
-            return static_cast<const T&>( idx.create( [&](object& o)
-            {
-               assert( dynamic_cast<T*>(&o) );
-               constructor( static_cast<T&>(o) );
-            } ));
+            T item;
+            item.id = idx.get_next_id();
+            constructor( item );
+            const object& result = idx.insert( std::move( item ) );
+            idx.use_next_id();
+            return static_cast<const T&>( result );
          }
 
          ///These methods are used to retrieve indexes on the object_database. All public index accessors are const-access only.
@@ -91,6 +95,38 @@ namespace graphene { namespace db {
             get_mutable_index(obj.id).modify(obj,m);
          }
 
+         /**
+          * Modifies every object in [first, last) with m. The range is collected before the first change, so it
+          * may come from an index whose keys m changes; no object is skipped or visited twice.
+          */
+         template<typename Iterator, typename Lambda>
+         void modify_range( Iterator first, Iterator last, const Lambda& m ) {
+            typedef typename std::iterator_traits<Iterator>::value_type T;
+            vector<const object*> objs;
+            for( ; first != last; ++first )
+               objs.push_back( &*first );
+            if( objs.empty() )
+               return;
+            get_mutable_index( T::space_id, T::type_id ).modify_batch( objs, [&m]( object& o ) {
+               assert( dynamic_cast<T*>(&o) );
+               m( static_cast<T&>(o) );
+            });
+         }
+
+         /// Removes every object in [first, last), the range is collected before the first removal
+         template<typename Iterator>
+         void remove_range( Iterator first, Iterator last ) {
+            typedef typename std::iterator_traits<Iterator>::value_type T;
+            vector<const object*> objs;
+            for( ; first != last; ++first )
+               objs.push_back( &*first );
+            if( objs.empty() )
+               return;
+            index& idx = get_mutable_index( T::space_id, T::type_id );
+            for( const object* obj : objs )
+               idx.remove( *obj );
+         }
+
          ///@}
 
          template<typename T>
@@ -121,11 +157,24 @@ namespace graphene { namespace db {
             return static_cast<const T*>(obj);
          }
 
+         /// Indexes with a dense_id_table are looked up here directly, without a call through the index
          template<uint8_t SpaceID, uint8_t TypeID, typename T>
-         const T* find( object_id<SpaceID,TypeID,T> id )const { return find<T>(id); }
+         const T* find( object_id<SpaceID,TypeID,T> id )const
+         {
+            const index& idx = get_index( SpaceID, TypeID );
+            const dense_id_table* dense = idx.dense_ids();
+            const object* obj = dense ? dense->find( id.instance.value ) : idx.find( id );
+            assert(  !obj || nullptr != dynamic_cast<const T*>(obj) );
+            return static_cast<const T*>(obj);
+         }
 
          template<uint8_t SpaceID, uint8_t TypeID, typename T>
-         const T& get( object_id<SpaceID,TypeID,T> id )const { return get<T>(id); }
+         const T& get( object_id<SpaceID,TypeID,T> id )const
+         {
+            const T* obj = find( id );
+            FC_ASSERT( obj != nullptr, "Unable to find Object ${id}", ("id",id) );
+            return *obj;
+         }
 
          template<typename IndexType>
          IndexType* add_index()
@@ -167,11 +216,14 @@ namespace graphene { namespace db {
          friend class base_primary_index;
          friend class undo_database;
          void save_undo( const object& obj );
+         void save_undo( const vector<const object*>& objs );
          void save_undo_add( const object& obj );
          void save_undo_remove( const object& obj );
 
          fc::path                                                  _data_dir;
          vector< vector< unique_ptr<index> > >                     _index;
+         /// index generations as of the state in _data_dir / "object_database", by (space, type)
+         std::map< std::pair<uint32_t,uint32_t>, uint64_t >        _flushed_generations;
    };
 
 } } // graphene::db
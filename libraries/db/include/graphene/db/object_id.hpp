@@ -23,6 +23,7 @@
  */
 #pragma once
 #include <fc/exception/exception.hpp>
+#include <fc/io/json_writer_fwd.hpp>
 #include <fc/io/varint.hpp>
 #include <memory>
 #define GRAPHENE_DB_MAX_INSTANCE_ID  (uint64_t(-1)>>16)
@@ -166,6 +167,10 @@ struct reflector<graphene::db::object_id<SpaceID,TypeID,T> >
     }
 };
 
+template<> struct json_use_variant<graphene::db::object_id_type> : std::true_type {};
+template<uint8_t SpaceID, uint8_t TypeID, typename T>
+struct json_use_variant<graphene::db::object_id<SpaceID,TypeID,T>> : std::true_type {};
+
 
  inline void to_variant( const graphene::db::object_id_type& var,  fc::variant& vo, uint32_t max_depth = 1 )
  {
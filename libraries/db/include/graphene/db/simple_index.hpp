@@ -59,6 +59,9 @@ namespace graphene { namespace db {
             modify_callback( *_objects[obj.id.instance()] );
          }
 
+         /// Objects are found by their instance only, nothing to do after a change
+         void reindex( const object& obj ) {}
+
          virtual const object& insert( object&& obj )override
          {
             auto instance = obj.id.instance();
@@ -88,7 +91,7 @@ namespace graphene { namespace db {
             return _objects[instance].get();
          }
 
-         virtual void inspect_all_objects(std::function<void (const object&)> inspector)const override
+         virtual void inspect_all_objects(const std::function<void (const object&)>& inspector)const override
          {
             try {
                for( const auto& ptr : _objects )
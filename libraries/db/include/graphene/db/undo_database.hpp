@@ -24,6 +24,8 @@
 #pragma once
 #include <graphene/db/object.hpp>
 #include <deque>
+#include <memory>
+#include <vector>
 #include <fc/exception/exception.hpp>
 
 namespace graphene { namespace db {
@@ -32,12 +34,56 @@ namespace graphene { namespace db {
    using fc::flat_set;
    class object_database;
 
+   /**
+    * @brief bump allocator for the object copies of an undo_state
+    *
+    * Memory is only handed out, never freed individually. reset() makes all of it available again once the
+    * objects in it have been destroyed, so a reused undo_state does not go back to the heap for every copy.
+    */
+   class undo_arena
+   {
+      public:
+         void* allocate( size_t size );
+         void  reset();
+         /// Takes over the memory of other, including the objects in it, and leaves other empty
+         void  splice( undo_arena& other );
+         /// Bytes handed out since the last reset()
+         size_t allocated()const { return _allocated; }
+
+      private:
+         struct chunk
+         {
+            std::unique_ptr<char[]> data;
+            size_t                  size = 0;
+         };
+
+         std::vector<chunk> _chunks;
+         /// the chunk that is allocated from, chunks before it are in use
+         size_t             _current = 0;
+         size_t             _used = 0;
+         size_t             _allocated = 0;
+   };
+
+   /// Destroys an object copy without freeing its memory, which belongs to the undo_arena of its undo_state
+   struct undo_object_deleter
+   {
+      void operator()( object* obj )const { obj->~object(); }
+   };
+   typedef std::unique_ptr<object, undo_object_deleter> undo_object_ptr;
+
    struct undo_state
    {
-      unordered_map<object_id_type, unique_ptr<object> > old_values;
+      /// declared first so that it outlives the object copies that live in it
+      undo_arena                                         arena;
+      unordered_map<object_id_type, undo_object_ptr >    old_values;
       unordered_map<object_id_type, object_id_type>      old_index_next_ids;
       std::unordered_set<object_id_type>                 new_ids;
-      unordered_map<object_id_type, unique_ptr<object> > removed;
+      unordered_map<object_id_type, undo_object_ptr >    removed;
+
+      /// @return a copy of obj that lives in the arena of this state
+      undo_object_ptr copy( const object& obj );
+      /// Empties the state for reuse, keeping the memory of its containers and arena
+      void            clear();
    };
 
 
@@ -98,6 +144,10 @@ namespace graphene { namespace db {
           * be removed if we undo.
           */
          void on_modify( const object& obj );
+         /**
+          * Same as calling on_modify for each of objs, but looks up the current undo state only once
+          */
+         void on_modify( const vector<const object*>& objs );
          /**
           * This should be called just before an object is removed.
           *
@@ -122,15 +172,27 @@ namespace graphene { namespace db {
          uint32_t active_sessions()const { return _active_sessions; }
 
          const undo_state& head()const;
+         /// Number of objects recorded in the current undo state, 0 if there is none
+         size_t head_object_count()const;
+         /// Bytes of object copies held by the current undo state, 0 if there is none
+         size_t head_undo_bytes()const;
 
       private:
          void undo();
          void merge();
          void commit();
 
+         /// enough for a block session and the nested sessions of its transactions
+         static size_t max_free_states() { return 16; }
+         void push_state();
+         void pop_state_front();
+         void pop_state_back();
+
          uint32_t                _active_sessions = 0;
          bool                    _disabled = true;
          std::deque<undo_state>  _stack;
+         /// emptied states that are reused by push_state()
+         std::vector<undo_state> _free_states;
          object_database&        _db;
          size_t                  _max_size = 256;
    };
@@ -25,10 +25,17 @@
 #include <graphene/db/index.hpp>
 #include <graphene/db/object_database.hpp>
 
+#include <fc/thread/parallel.hpp>
+
+#include <deque>
+
 namespace graphene { namespace db {
    void base_primary_index::save_undo( const object& obj )
    { _db.save_undo( obj ); }
 
+   void base_primary_index::save_undo( const vector<const object*>& objs )
+   { _db.save_undo( objs ); }
+
    void base_primary_index::on_add( const object& obj )
    {
       _db.save_undo_add( obj );
@@ -40,4 +47,42 @@ namespace graphene { namespace db {
 
    void base_primary_index::on_modify( const object& obj )
    {for( auto ob : _observers ) ob->on_modify(  obj ); }
+
+   void base_primary_index::run_ordered( size_t tasks, const std::function<shared_ptr<void>(size_t)>& produce,
+                                         const std::function<void(const shared_ptr<void>&)>& consume )
+   {
+      if( tasks == 0 )
+         return;
+      if( tasks == 1 )
+      {
+         consume( produce( 0 ) );
+         return;
+      }
+      const size_t max_running = 8;
+      std::deque< fc::future< shared_ptr<void> > > running;
+      size_t next = 0;
+      try
+      {
+         while( next < tasks || !running.empty() )
+         {
+            for( ; next < tasks && running.size() < max_running; ++next )
+            {
+               const size_t task = next;
+               running.push_back( fc::do_parallel( [&produce,task]() { return produce( task ); } ) );
+            }
+            shared_ptr<void> result = running.front().wait();
+            running.pop_front();
+            consume( result );
+         }
+      }
+      catch( ... )
+      {
+         // the running tasks still use the data of the caller
+         for( auto& task : running )
+         {
+            try { task.wait(); } catch( ... ) {}
+         }
+         throw;
+      }
+   }
 } } // graphene::chain
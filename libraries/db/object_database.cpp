@@ -45,11 +45,16 @@ void object_database::close()
 
 const object* object_database::find_object( object_id_type id )const
 {
-   return get_index(id.space(),id.type()).find( id );
+   const index& idx = get_index(id.space(),id.type());
+   if( const dense_id_table* dense = idx.dense_ids() )
+      return dense->find( id.instance() );
+   return idx.find( id );
 }
 const object& object_database::get_object( object_id_type id )const
 {
-   return get_index(id.space(),id.type()).get( id );
+   const object* obj = find_object( id );
+   FC_ASSERT( obj != nullptr, "Unable to find Object ${id}", ("id",id) );
+   return *obj;
 }
 
 const index& object_database::get_index(uint8_t space_id, uint8_t type_id)const
@@ -72,26 +77,54 @@ index& object_database::get_mutable_index(uint8_t space_id, uint8_t type_id)
 void object_database::flush()
 {
 //   ilog("Save object_database in ${d}", ("d", _data_dir));
+   // leftovers of an interrupted flush would get in the way of the hard links below
+   fc::remove_all( _data_dir / "object_database.tmp" );
    fc::create_directories( _data_dir / "object_database.tmp" / "lock" );
    std::vector<fc::future<void>> tasks;
    tasks.reserve(200);
+   std::map< std::pair<uint32_t,uint32_t>, uint64_t > generations;
+   uint32_t unchanged = 0;
    for( uint32_t space = 0; space < _index.size(); ++space )
    {
       fc::create_directories( _data_dir / "object_database.tmp" / fc::to_string(space) );
       const auto types = _index[space].size();
       for( uint32_t type = 0; type  <  types; ++type )
          if( _index[space][type] )
+         {
+            const auto key = std::make_pair( space, type );
+            const uint64_t generation = _index[space][type]->get_generation();
+            generations[key] = generation;
+
+            // an index that did not change since it was last opened or flushed is still on disk as it is
+            const fc::path saved = _data_dir / "object_database" / fc::to_string(space)/fc::to_string(type);
+            auto itr = _flushed_generations.find( key );
+            if( itr != _flushed_generations.end() && itr->second == generation && fc::exists( saved ) )
+            {
+               try
+               {
+                  fc::create_hard_link( saved, _data_dir / "object_database.tmp" / fc::to_string(space)/fc::to_string(type) );
+                  ++unchanged;
+                  continue;
+               }
+               catch( const fc::exception& e )
+               {
+                  wlog( "Unable to link ${f}, saving it instead: ${e}", ("f", saved)("e", e.to_string()) );
+               }
+            }
             tasks.push_back( fc::do_parallel( [this,space,type] () {
                _index[space][type]->save( _data_dir / "object_database.tmp" / fc::to_string(space)/fc::to_string(type) );
             } ) );
+         }
    }
    for( auto& task : tasks )
       task.wait();
+   ilog( "Saved ${n} indexes of the object database, ${u} were unchanged", ("n", tasks.size())("u", unchanged) );
    fc::remove_all( _data_dir / "object_database.tmp" / "lock" );
    if( fc::exists( _data_dir / "object_database" ) )
       fc::rename( _data_dir / "object_database", _data_dir / "object_database.old" );
    fc::rename( _data_dir / "object_database.tmp", _data_dir / "object_database" );
    fc::remove_all( _data_dir / "object_database.old" );
+   _flushed_generations = std::move( generations );
 }
 
 void object_database::wipe(const fc::path& data_dir)
@@ -99,6 +132,7 @@ void object_database::wipe(const fc::path& data_dir)
    close();
    ilog("Wiping object database...");
    fc::remove_all(data_dir / "object_database");
+   _flushed_generations.clear();
    ilog("Done wiping object databse.");
 }
 
@@ -121,6 +155,10 @@ void object_database::open(const fc::path& data_dir)
             } ) );
    for( auto& task : tasks )
       task.wait();
+   for( uint32_t space = 0; space < _index.size(); ++space )
+      for( uint32_t type = 0; type  < _index[space].size(); ++type )
+         if( _index[space][type] )
+            _flushed_generations[std::make_pair( space, type )] = _index[space][type]->get_generation();
    ilog( "Done opening object database." );
 
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
@@ -136,6 +174,11 @@ void object_database::save_undo( const object& obj )
    _undo_db.on_modify( obj );
 }
 
+void object_database::save_undo( const vector<const object*>& objs )
+{
+   _undo_db.on_modify( objs );
+}
+
 void object_database::save_undo_add( const object& obj )
 {
    _undo_db.on_create( obj );
@@ -25,8 +25,111 @@
 #include <graphene/db/undo_database.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
 namespace graphene { namespace db {
 
+void* undo_arena::allocate( size_t size )
+{
+   const size_t alignment = alignof( std::max_align_t );
+   size = ( size + alignment - 1 ) & ~( alignment - 1 );
+   while( _current < _chunks.size() && _used + size > _chunks[_current].size )
+   {
+      ++_current;
+      _used = 0;
+   }
+   if( _current == _chunks.size() )
+   {
+      chunk c;
+      c.size = std::max<size_t>( size, 64 * 1024 );
+      c.data.reset( new char[c.size] );
+      _chunks.push_back( std::move( c ) );
+      _used = 0;
+   }
+   void* result = _chunks[_current].data.get() + _used;
+   _used += size;
+   _allocated += size;
+   return result;
+}
+
+void undo_arena::reset()
+{
+   // don't let a single huge state, e.g. of a maintenance block, pin its memory forever
+   size_t kept_chunks = 0;
+   size_t kept_size = 0;
+   while( kept_chunks < _chunks.size() && kept_size + _chunks[kept_chunks].size <= 1024 * 1024 )
+      kept_size += _chunks[kept_chunks++].size;
+   _chunks.erase( _chunks.begin() + kept_chunks, _chunks.end() );
+   _current = 0;
+   _used = 0;
+   _allocated = 0;
+}
+
+void undo_arena::splice( undo_arena& other )
+{
+   const size_t used_chunks = std::min( other._current + ( other._used > 0 ? 1 : 0 ), other._chunks.size() );
+   // the chunks holding objects go before our current chunk, so they are never allocated from until reset()
+   _chunks.insert( _chunks.begin() + _current,
+                   std::make_move_iterator( other._chunks.begin() ),
+                   std::make_move_iterator( other._chunks.begin() + used_chunks ) );
+   _current += used_chunks;
+   _chunks.insert( _chunks.end(),
+                   std::make_move_iterator( other._chunks.begin() + used_chunks ),
+                   std::make_move_iterator( other._chunks.end() ) );
+   other._chunks.clear();
+   other._current = 0;
+   other._used = 0;
+   _allocated += other._allocated;
+   other._allocated = 0;
+}
+
+undo_object_ptr undo_state::copy( const object& obj )
+{
+   return undo_object_ptr( obj.clone_into( arena.allocate( obj.object_size() ) ) );
+}
+
+void undo_state::clear()
+{
+   old_values.clear();
+   old_index_next_ids.clear();
+   new_ids.clear();
+   removed.clear();
+   arena.reset();
+}
+
+void undo_database::push_state()
+{
+   if( _free_states.empty() )
+      _stack.emplace_back();
+   else
+   {
+      _stack.emplace_back( std::move( _free_states.back() ) );
+      _free_states.pop_back();
+   }
+}
+
+void undo_database::pop_state_front()
+{
+   if( _free_states.size() < max_free_states() )
+   {
+      _stack.front().clear();
+      _free_states.emplace_back( std::move( _stack.front() ) );
+   }
+   _stack.pop_front();
+}
+
+void undo_database::pop_state_back()
+{
+   if( _free_states.size() < max_free_states() )
+   {
+      _stack.back().clear();
+      _free_states.emplace_back( std::move( _stack.back() ) );
+   }
+   _stack.pop_back();
+}
+
 void undo_database::enable()  { _disabled = false; }
 void undo_database::disable() { _disabled = true; }
 
@@ -51,9 +154,9 @@ undo_database::session undo_database::start_undo_session( bool force_enable )
       _disabled = false;
 
    while( size() > max_size() )
-      _stack.pop_front();
+      pop_state_front();
 
-   _stack.emplace_back();
+   push_state();
    ++_active_sessions;
    return session(*this, disable_on_exit );
 }
@@ -62,7 +165,7 @@ void undo_database::on_create( const object& obj )
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      push_state();
    auto& state = _stack.back();
    auto index_id = object_id_type( obj.id.space(), obj.id.type(), 0 );
    auto itr = state.old_index_next_ids.find( index_id );
@@ -75,20 +178,37 @@ void undo_database::on_modify( const object& obj )
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      push_state();
    auto& state = _stack.back();
    if( state.new_ids.find(obj.id) != state.new_ids.end() )
       return;
    auto itr =  state.old_values.find(obj.id);
    if( itr != state.old_values.end() ) return;
-   state.old_values[obj.id] = obj.clone();
+   state.old_values[obj.id] = state.copy( obj );
+}
+void undo_database::on_modify( const vector<const object*>& objs )
+{
+   if( _disabled ) return;
+
+   if( _stack.empty() )
+      push_state();
+   auto& state = _stack.back();
+   state.old_values.reserve( state.old_values.size() + objs.size() );
+   for( const object* obj : objs )
+   {
+      if( state.new_ids.find(obj->id) != state.new_ids.end() )
+         continue;
+      auto itr = state.old_values.find(obj->id);
+      if( itr != state.old_values.end() ) continue;
+      state.old_values[obj->id] = state.copy( *obj );
+   }
 }
 void undo_database::on_remove( const object& obj )
 {
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      push_state();
    undo_state& state = _stack.back();
    if( state.new_ids.count(obj.id) )
    {
@@ -102,7 +222,7 @@ void undo_database::on_remove( const object& obj )
       return;
    }
    if( state.removed.count(obj.id) ) return;
-   state.removed[obj.id] = obj.clone();
+   state.removed[obj.id] = state.copy( obj );
 }
 
 void undo_database::undo()
@@ -130,7 +250,7 @@ void undo_database::undo()
    for( auto& item : state.removed )
       _db.insert( std::move(*item.second) );
 
-   _stack.pop_back();
+   pop_state_back();
    enable();
    --_active_sessions;
 } FC_CAPTURE_AND_RETHROW() }
@@ -140,7 +260,7 @@ void undo_database::merge()
    FC_ASSERT( _active_sessions > 0 );
    if( _active_sessions == 1 && _stack.size() == 1 )
    {
-      _stack.pop_back();
+      pop_state_back();
       --_active_sessions;
       return;
    }
@@ -252,7 +372,9 @@ void undo_database::merge()
       // nop + del(was=Y) -> del(was=Y)
       prev_state.removed[obj.second->id] = std::move(obj.second);
    }
-   _stack.pop_back();
+   // copies that were moved over to prev_state still live in the arena of state
+   prev_state.arena.splice( state.arena );
+   pop_state_back();
    --_active_sessions;
 }
 void undo_database::commit()
@@ -288,7 +410,7 @@ void undo_database::pop_commit()
       for( auto& item : state.removed )
          _db.insert( std::move(*item.second) );
 
-      _stack.pop_back();
+      pop_state_back();
    }
    catch ( const fc::exception& e )
    {
@@ -304,4 +426,19 @@ const undo_state& undo_database::head()const
    return _stack.back();
 }
 
+size_t undo_database::head_object_count()const
+{
+   if( _stack.empty() )
+      return 0;
+   const undo_state& state = _stack.back();
+   return state.old_values.size() + state.new_ids.size() + state.removed.size();
+}
+
+size_t undo_database::head_undo_bytes()const
+{
+   if( _stack.empty() )
+      return 0;
+   return _stack.back().arena.allocated();
+}
+
 } } // graphene::db
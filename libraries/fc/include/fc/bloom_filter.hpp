@@ -339,6 +339,46 @@ public:
       return contains(reinterpret_cast<const unsigned char*>(data),length);
    }
 
+   /*
+     The bits a key sets do not depend on the content of the filter, only on the
+     parameters it was built from. A key can thus be hashed once with compute_bits()
+     and then tested with contains_bits() against any number of filters built from
+     the same bloom_parameters.
+   */
+   inline void compute_bits(const unsigned char* key_begin, const std::size_t length, std::vector<std::size_t>& bits) const
+   {
+      std::size_t bit = 0;
+      bits.resize(salt_.size());
+      for (std::size_t i = 0; i < salt_.size(); ++i)
+      {
+         compute_indices(hash_ap(key_begin,length,salt_[i]),bits[i],bit);
+      }
+   }
+
+   template<typename T>
+   inline void compute_bits(const T& t, std::vector<std::size_t>& bits) const
+   {
+      // Note: T must be a C++ POD type.
+      compute_bits(reinterpret_cast<const unsigned char*>(&t),sizeof(T),bits);
+   }
+
+   inline bool contains_bit(const std::size_t bit_index) const
+   {
+      return (bit_table_[bit_index / bits_per_char] & bit_mask[bit_index % bits_per_char]) != 0;
+   }
+
+   inline bool contains_bits(const std::vector<std::size_t>& bits) const
+   {
+      for (std::size_t bit_index : bits)
+      {
+         if (!contains_bit(bit_index))
+         {
+            return false;
+         }
+      }
+      return true;
+   }
+
    template<typename InputIterator>
    inline InputIterator contains_all(const InputIterator begin, const InputIterator end) const
    {
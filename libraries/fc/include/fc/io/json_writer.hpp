@@ -0,0 +1,245 @@
+#pragma once
+#include <fc/container/flat_fwd.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+#include <fc/io/json_writer_fwd.hpp>
+#include <fc/optional.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/safe.hpp>
+#include <fc/static_variant.hpp>
+#include <fc/uint128.hpp>
+#include <fc/variant.hpp>
+#include <fc/variant_object.hpp>
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#define DEFAULT_MAX_RECURSION_DEPTH 200
+
+namespace fc
+{
+   /**
+    *  Writes values as JSON straight from their reflection into a string, without building a tree of variants
+    *  first. The output is the same as fc::json::to_string( fc::variant( v, max_depth ),
+    *  fc::json::stringify_large_ints_and_doubles, max_depth ), byte for byte.
+    *
+    *  Reflected structs and enums, integers, strings, optionals, static_variants and the containers that
+    *  fc::variant knows are written directly. Everything else is converted to a variant on its own and written
+    *  like fc::json does, which keeps the output identical for types with a custom to_variant().
+    */
+   class json_writer
+   {
+      public:
+         json_writer( std::string& out, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH )
+            : _out( out ), _max_depth( max_depth ) {}
+
+         void write( bool b )                 { _out += b ? "true" : "false"; }
+         void write( int8_t i )               { write_int64( i ); }
+         void write( int16_t i )              { write_int64( i ); }
+         void write( int32_t i )              { write_int64( i ); }
+         void write( int64_t i )              { write_int64( i ); }
+         void write( uint8_t u )              { write_uint64( u ); }
+         void write( uint16_t u )             { write_uint64( u ); }
+         void write( uint32_t u )             { write_uint64( u ); }
+         void write( uint64_t u )             { write_uint64( u ); }
+         void write( float f )                { write( double( f ) ); }
+         void write( double d );
+         void write( const std::string& s );
+         void write( const char* s )          { write( std::string( s ) ); }
+         void write( const variant& v );
+         void write( const variants& v );
+         void write( const variant_object& v );
+         void write( const mutable_variant_object& v );
+         void write( const std::vector<char>& v )   { write_variant( variant( v, _max_depth ) ); }
+         // reflected, but written as strings by their to_variant()
+         void write( const blob& b )                { write_variant( variant( b, _max_depth ) ); }
+         void write( const uint128& u )             { write_variant( variant( u, _max_depth ) ); }
+
+         template<typename T>
+         void write( const safe<T>& s )       { write( s.value ); }
+
+         template<typename T>
+         void write( const optional<T>& o )
+         {
+            if( o.valid() )
+               write( *o );
+            else
+               _out += "null";
+         }
+
+         template<typename A, typename B>
+         void write( const std::pair<A,B>& p )
+         {
+            enter();
+            _out += '[';
+            write( p.first );
+            _out += ',';
+            write( p.second );
+            _out += ']';
+            leave();
+         }
+
+         template<typename T>
+         void write( const std::vector<T>& v )                 { write_range( v ); }
+         template<typename T>
+         void write( const std::deque<T>& v )                  { write_range( v ); }
+         template<typename T>
+         void write( const std::set<T>& v )                    { write_range( v ); }
+         template<typename T, typename... A>
+         void write( const flat_set<T, A...>& v )              { write_range( v ); }
+         template<typename K, typename T>
+         void write( const std::map<K,T>& v )                  { write_range( v ); }
+         template<typename K, typename T>
+         void write( const std::unordered_map<K,T>& v )        { write_range( v ); }
+         template<typename K, typename... T>
+         void write( const flat_map<K, T...>& v )              { write_range( v ); }
+
+         template<typename... T>
+         void write( const static_variant<T...>& sv )
+         {
+            enter();
+            _out += '[';
+            write_int64( sv.which() );
+            _out += ',';
+            sv.visit( alternative_writer{ *this } );
+            _out += ']';
+            leave();
+         }
+
+         /** Reflected structs and enums, everything else goes through its to_variant() */
+         template<typename T>
+         void write( const T& v )
+         {
+            typedef std::integral_constant<bool, fc::reflector<T>::is_defined::value
+                                                 && !json_use_variant<T>::value> direct;
+            typedef std::integral_constant<bool, fc::reflector<T>::is_enum::value> is_enum;
+            write_reflected( v, direct(), is_enum() );
+         }
+
+      private:
+         /// static_variant converts its value with to_variant(), which turns plain values into numbers
+         struct alternative_writer
+         {
+            typedef void result_type;
+            json_writer& w;
+            template<typename T>
+            void operator()( const T& v )const { write( v, std::is_class<T>() ); }
+            template<typename T>
+            void write( const T& v, std::true_type )const { w.write( v ); }
+            template<typename T>
+            void write( const T& v, std::false_type )const
+            {
+               variant var;
+               to_variant( v, var, w._max_depth );
+               w.write_variant( var );
+            }
+         };
+
+         template<typename T>
+         class member_writer
+         {
+            public:
+               member_writer( json_writer& w, const T& v ) : _w( w ), _val( v ) {}
+
+               template<typename Member, class Class, Member (Class::*member)>
+               void operator()( const char* name )const
+               {
+                  add( name, _val.*member );
+               }
+
+            private:
+               template<typename M>
+               void add( const char* name, const optional<M>& v )const
+               {
+                  if( v.valid() )
+                     add( name, *v );
+               }
+               template<typename M>
+               void add( const char* name, const M& v )const
+               {
+                  if( _first )
+                     _first = false;
+                  else
+                     _w._out += ',';
+                  _w.write_string( name );
+                  _w._out += ':';
+                  _w.write( v );
+               }
+
+               json_writer&  _w;
+               const T&      _val;
+               mutable bool  _first = true;
+         };
+
+         template<typename T, typename IsEnum>
+         void write_reflected( const T& v, std::false_type, IsEnum )
+         {
+            write_variant( variant( v, _max_depth ) );
+         }
+         template<typename T>
+         void write_reflected( const T& v, std::true_type, std::true_type )
+         {
+            write( std::string( fc::reflector<T>::to_fc_string( v ) ) );
+         }
+         template<typename T>
+         void write_reflected( const T& v, std::true_type, std::false_type )
+         {
+            enter();
+            _out += '{';
+            fc::reflector<T>::visit( member_writer<T>( *this, v ) );
+            _out += '}';
+            leave();
+         }
+
+         template<typename Range>
+         void write_range( const Range& r )
+         {
+            enter();
+            _out += '[';
+            bool first = true;
+            for( const auto& item : r )
+            {
+               if( first )
+                  first = false;
+               else
+                  _out += ',';
+               write( item );
+            }
+            _out += ']';
+            leave();
+         }
+
+         void enter()
+         {
+            FC_ASSERT( _max_depth > 0, "Recursion depth exceeded!" );
+            --_max_depth;
+         }
+         void leave() { ++_max_depth; }
+
+         void write_int64( int64_t i );
+         void write_uint64( uint64_t u );
+         void write_string( const char* s, size_t len );
+         void write_string( const char* s );
+         void write_variant( const variant& v );
+
+         std::string& _out;
+         uint32_t     _max_depth;
+   };
+
+   /** Convenience function that returns the JSON of v, @see json_writer */
+   template<typename T>
+   std::string to_json_string( const T& v, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH )
+   {
+      std::string out;
+      json_writer( out, max_depth ).write( v );
+      return out;
+   }
+
+} // fc
+
+#undef DEFAULT_MAX_RECURSION_DEPTH
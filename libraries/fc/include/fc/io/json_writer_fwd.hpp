@@ -0,0 +1,15 @@
+#pragma once
+#include <type_traits>
+
+namespace fc
+{
+   class json_writer;
+
+   /**
+    *  Reflected types that also have a to_variant() of their own, like keys and addresses that are written as
+    *  strings, have to specialize this to true. json_writer then goes through their to_variant().
+    */
+   template<typename T>
+   struct json_use_variant : std::false_type {};
+
+} // fc
@@ -3,6 +3,7 @@
 #include <fc/optional.hpp>
 #include <fc/api.hpp>
 #include <fc/any.hpp>
+#include <fc/io/json_writer.hpp>
 #include <memory>
 #include <vector>
 #include <functional>
@@ -100,6 +101,9 @@ namespace fc {
    class generic_api
    {
       public:
+         /// Appends the JSON of a method's result to the string
+         typedef std::function<void(const variants&, std::string&)> json_method;
+
          template<typename Api>
          generic_api( const Api& a, const std::shared_ptr<fc::api_connection>& c );
 
@@ -118,6 +122,18 @@ namespace fc {
             return _methods[method_id](args);
          }
 
+         /** Like call(), but appends the JSON of the result to out without converting it to a variant first */
+         void call_json( const string& name, const variants& args, std::string& out )
+         {
+            auto itr = _by_name.find(name);
+            FC_ASSERT( itr != _by_name.end(), "no method with name '${name}'", ("name",name)("api",_by_name) );
+            const auto& json_method = _json_methods[itr->second];
+            if( json_method )
+               json_method( args, out );
+            else
+               json_writer( out, _max_conversion_depth ).write( call( itr->second, args ) );
+         }
+
          std::weak_ptr< fc::api_connection > get_connection()
          {
             return _api_connection;
@@ -190,9 +206,26 @@ namespace fc {
             template<typename ... Args>
             std::function<variant(const fc::variants&)> to_generic( const std::function<void(Args...)>& f )const;
 
+            /// Methods that return apis or nothing have no JSON path of their own, call_json() goes through call()
+            template<typename Interface, typename Adaptor, typename ... Args>
+            json_method to_json( const std::function<api<Interface,Adaptor>(Args...)>& f )const { return json_method(); }
+
+            template<typename Interface, typename Adaptor, typename ... Args>
+            json_method to_json( const std::function<fc::optional<api<Interface,Adaptor>>(Args...)>& f )const { return json_method(); }
+
+            template<typename ... Args>
+            json_method to_json( const std::function<fc::api_ptr(Args...)>& f )const { return json_method(); }
+
+            template<typename R, typename ... Args>
+            json_method to_json( const std::function<R(Args...)>& f )const;
+
+            template<typename ... Args>
+            json_method to_json( const std::function<void(Args...)>& f )const { return json_method(); }
+
             template<typename Result, typename... Args>
             void operator()( const char* name, std::function<Result(Args...)>& memb )const {
                _api._methods.emplace_back( to_generic( memb ) );
+               _api._json_methods.emplace_back( to_json( memb ) );
                _api._by_name[name] = _api._methods.size() - 1;
             }
 
@@ -205,6 +238,8 @@ namespace fc {
          fc::any                                                 _api;
          std::map< std::string, uint32_t >                       _by_name;
          std::vector< std::function<variant(const variants&)> >  _methods;
+         std::vector< json_method >                              _json_methods;
+         uint32_t                                                _max_conversion_depth = 1;
    }; // class generic_api
 
 
@@ -234,6 +269,12 @@ namespace fc {
             FC_ASSERT( _local_apis.size() > api_id );
             return _local_apis[api_id]->call( method_name, args );
          }
+         /** Appends the JSON of the result of the call to out, @see generic_api::call_json */
+         void receive_call_json( api_id_type api_id, const string& method_name, const variants& args, std::string& out )const
+         {
+            FC_ASSERT( _local_apis.size() > api_id );
+            _local_apis[api_id]->call_json( method_name, args, out );
+         }
          variant receive_callback( uint64_t callback_id,  const variants& args = variants() )const
          {
             FC_ASSERT( _local_callbacks.size() > callback_id );
@@ -385,7 +426,7 @@ namespace fc {
 
    template<typename Api>
    generic_api::generic_api( const Api& a, const std::shared_ptr<fc::api_connection>& c )
-   :_api_connection(c),_api(a)
+   :_api_connection(c),_api(a),_max_conversion_depth(c->_max_conversion_depth)
    {
       boost::any_cast<const Api&>(a)->visit( api_visitor( *this, c ) );
    }
@@ -450,6 +491,18 @@ namespace fc {
       };
    }
 
+   template<typename R, typename ... Args>
+   generic_api::json_method generic_api::api_visitor::to_json( const std::function<R(Args...)>& f )const
+   {
+      auto con = _api_con.lock();
+      FC_ASSERT( con, "not connected" );
+      uint32_t max_depth = con->_max_conversion_depth;
+      generic_api* gapi = &_api;
+      return [f,gapi,max_depth]( const variants& args, std::string& out ) {
+         json_writer( out, max_depth ).write( gapi->call_generic( f, args.begin(), args.end(), max_depth ) );
+      };
+   }
+
    template<typename ... Args>
    std::function<variant(const fc::variants&)> generic_api::api_visitor::to_generic( const std::function<void(Args...)>& f )const
    {
@@ -31,6 +31,14 @@ namespace fc { namespace rpc {
 
          fc::http::websocket_connection&  _connection;
          fc::rpc::state                   _rpc_state;
+
+      private:
+         api_id_type resolve_api_id( const variant& api )const;
+         /// Writes the reply to an api call straight from its result, false for calls that are not api calls
+         bool reply_json( const request& call, std::string& reply )const;
+
+         /// Reply buffers of earlier messages, reused so that a reply does not grow a new string every time
+         std::vector<std::string>         _reply_buffers;
    };
 
 } } // namespace fc::rpc
@@ -0,0 +1,113 @@
+#include <fc/io/json_writer.hpp>
+#include <fc/io/sstream.hpp>
+
+#include <cstring>
+
+namespace fc
+{
+   // the same rules as the stringify_large_ints_and_doubles formatting of fc::json
+   void json_writer::write_int64( int64_t i )
+   {
+      if( i > INT32_MAX || i < INT32_MIN )
+      {
+         _out += '"';
+         _out += std::to_string( i );
+         _out += '"';
+      }
+      else
+         _out += std::to_string( i );
+   }
+
+   void json_writer::write_uint64( uint64_t u )
+   {
+      if( u > 0xffffffff )
+      {
+         _out += '"';
+         _out += std::to_string( u );
+         _out += '"';
+      }
+      else
+         _out += std::to_string( u );
+   }
+
+   void json_writer::write( double d )
+   {
+      _out += '"';
+      _out += variant( d ).as_string();
+      _out += '"';
+   }
+
+   void json_writer::write( const std::string& s )
+   {
+      write_string( s.data(), s.size() );
+   }
+
+   void json_writer::write_string( const char* s )
+   {
+      write_string( s, strlen( s ) );
+   }
+
+   /// Escapes like escape_string() in json.cpp
+   void json_writer::write_string( const char* s, size_t len )
+   {
+      static const char hex[] = "0123456789abcdef";
+      _out.reserve( _out.size() + len + 2 );
+      _out += '"';
+      for( size_t i = 0; i < len; ++i )
+      {
+         const char c = s[i];
+         switch( c )
+         {
+            case '\b': _out += "\\b"; break;
+            case '\f': _out += "\\f"; break;
+            case '\n': _out += "\\n"; break;
+            case '\r': _out += "\\r"; break;
+            case '\t': _out += "\\t"; break;
+            case '\\': _out += "\\\\"; break;
+            case '\"': _out += "\\\""; break;
+            default:
+               if( (unsigned char)c < 0x20 )
+               {
+                  _out += "\\u00";
+                  _out += hex[ (c >> 4) & 0xf ];
+                  _out += hex[ c & 0xf ];
+               }
+               else
+                  _out += c;
+         }
+      }
+      _out += '"';
+   }
+
+   void json_writer::write_variant( const variant& v )
+   {
+      fc::stringstream ss;
+      json::to_stream( ss, v, json::stringify_large_ints_and_doubles, _max_depth );
+      _out += ss.str();
+   }
+
+   void json_writer::write( const variant& v )
+   {
+      write_variant( v );
+   }
+
+   void json_writer::write( const variants& v )
+   {
+      fc::stringstream ss;
+      json::to_stream( ss, v, json::stringify_large_ints_and_doubles, _max_depth );
+      _out += ss.str();
+   }
+
+   void json_writer::write( const variant_object& v )
+   {
+      fc::stringstream ss;
+      json::to_stream( ss, v, json::stringify_large_ints_and_doubles, _max_depth );
+      _out += ss.str();
+   }
+
+   void json_writer::write( const mutable_variant_object& v )
+   {
+      write( variant_object( v ) );
+   }
+
+} // fc
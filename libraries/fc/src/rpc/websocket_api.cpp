@@ -13,17 +13,8 @@ websocket_api_connection::websocket_api_connection( fc::http::websocket_connecti
    _rpc_state.add_method( "call", [this]( const variants& args ) -> variant
    {
       FC_ASSERT( args.size() == 3 && args[2].is_array() );
-      api_id_type api_id;
-      if( args[0].is_string() )
-      {
-         variant subresult = this->receive_call( 1, args[0].as_string() );
-         api_id = subresult.as_uint64();
-      }
-      else
-         api_id = args[0].as_uint64();
-
       return this->receive_call(
-         api_id,
+         resolve_api_id( args[0] ),
          args[1].as_string(),
          args[2].get_array() );
    } );
@@ -52,6 +43,37 @@ websocket_api_connection::websocket_api_connection( fc::http::websocket_connecti
    _connection.closed.connect( [this](){ closed(); } );
 }
 
+api_id_type websocket_api_connection::resolve_api_id( const variant& api )const
+{
+   if( api.is_string() )
+   {
+      variant subresult = this->receive_call( 1, api.as_string() );
+      return subresult.as_uint64();
+   }
+   return api.as_uint64();
+}
+
+bool websocket_api_connection::reply_json( const request& call, std::string& reply )const
+{
+   if( call.method == "notice" || call.method == "callback" )
+      return false;
+
+   // the same as fc::json::to_string( response( *call.id, result, "2.0" ) )
+   reply += "{\"id\":";
+   json_writer( reply, _max_conversion_depth ).write( int64_t( *call.id ) );
+   reply += ",\"jsonrpc\":\"2.0\",\"result\":";
+   if( call.method == "call" )
+   {
+      const auto& args = call.params;
+      FC_ASSERT( args.size() == 3 && args[2].is_array() );
+      this->receive_call_json( resolve_api_id( args[0] ), args[1].as_string(), args[2].get_array(), reply );
+   }
+   else
+      this->receive_call_json( 0, call.method, call.params, reply );
+   reply += '}';
+   return true;
+}
+
 variant websocket_api_connection::send_call(
    api_id_type api_id,
    string method_name,
@@ -103,7 +125,17 @@ std::string websocket_api_connection::on_message(
                auto start = time_point::now();
 #endif
 
-               auto result = _rpc_state.local_call( call.method, call.params );
+               std::string reply;
+               if( !_reply_buffers.empty() )
+               {
+                  reply = std::move( _reply_buffers.back() );
+                  _reply_buffers.pop_back();
+                  reply.clear();
+               }
+               const bool replied = call.id && reply_json( call, reply );
+               fc::variant result;
+               if( !replied )
+                  result = _rpc_state.local_call( call.method, call.params );
 
 #ifdef LOG_LONG_API
                auto end = time_point::now();
@@ -116,9 +148,16 @@ std::string websocket_api_connection::on_message(
 
                if( call.id )
                {
-                  auto reply = fc::json::to_string( response( *call.id, result, "2.0" ), fc::json::stringify_large_ints_and_doubles, _max_conversion_depth );
+                  if( !replied )
+                     reply = fc::json::to_string( response( *call.id, result, "2.0" ), fc::json::stringify_large_ints_and_doubles, _max_conversion_depth );
                   if( send_message )
+                  {
                      _connection.send_message( reply );
+                     // keep a few buffers for the next replies, but not the memory of exceptionally large ones
+                     if( _reply_buffers.size() < 4 && reply.capacity() <= 4 * 1024 * 1024 )
+                        _reply_buffers.push_back( std::move( reply ) );
+                     return string();
+                  }
                   return reply;
                }
             }
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2017 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <graphene/elasticsearch/bulk_sender.hpp>
+#include <graphene/utilities/elasticsearch.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/log/logger.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace elasticsearch {
+
+namespace {
+   /// The spool file starts with the offset of its first bulk that was not sent yet
+   const uint64_t spool_header_size = sizeof( uint64_t );
+}
+
+bulk_sender::bulk_sender( const std::string& url, const std::string& auth, uint16_t connections,
+                          uint32_t max_queued_bulks, uint16_t max_retries, const fc::path& spool_file )
+   : _url( url ), _auth( auth ), _max_queued_bulks( max_queued_bulks ), _max_retries( max_retries ),
+     _spool_file( spool_file )
+{
+   if( !fc::exists( _spool_file ) )
+   {
+      fc::create_directories( _spool_file.parent_path() );
+      std::ofstream create( _spool_file.generic_string(), std::ios::binary );
+   }
+   _spool.open( _spool_file.generic_string(), std::ios::in | std::ios::out | std::ios::binary );
+   FC_ASSERT( _spool, "Unable to open elasticsearch spool file ${f}", ("f",_spool_file) );
+   _spool.seekg( 0, std::ios::end );
+   _spool_size = _spool.tellg();
+   uint64_t sent_pos = 0;
+   if( _spool_size >= spool_header_size )
+   {
+      _spool.seekg( 0 );
+      _spool.read( (char*)&sent_pos, sizeof( sent_pos ) );
+   }
+   if( !_spool || sent_pos < spool_header_size || sent_pos > _spool_size )
+   {
+      if( _spool_size > 0 )
+         elog( "elasticsearch: dropping the spool file ${f}, its header is damaged", ("f",_spool_file) );
+      reset_spool();
+   }
+   else
+   {
+      _spool_read_pos = _spool_sent_pos = sent_pos;
+      if( _spool_size > _spool_read_pos )
+         ilog( "elasticsearch: ${n} bytes of bulks left in ${f} will be sent", ("n",_spool_size - _spool_read_pos)("f",_spool_file) );
+   }
+
+   for( uint16_t i = 0; i < std::max<uint16_t>( connections, 1 ); ++i )
+   {
+      _threads.emplace_back( new fc::thread( "elasticsearch_sender_" + fc::to_string( uint64_t(i) ) ) );
+      _loops.push_back( _threads.back()->async( [this,i] () { run( i ); }, "elasticsearch_send" ) );
+   }
+}
+
+bulk_sender::~bulk_sender()
+{
+   stop();
+}
+
+void bulk_sender::push( std::vector<std::string>&& lines )
+{
+   std::string body = graphene::utilities::joinBulkLines( lines );
+   std::lock_guard<std::mutex> lock( _mutex );
+   if( _stopping || _queue.size() >= _max_queued_bulks )
+      spool( body );
+   else
+      _queue.push_back( std::move( body ) );
+   _ready.notify_one();
+}
+
+void bulk_sender::stop()
+{
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      if( _stopping )
+         return;
+      _stopping = true;
+   }
+   _ready.notify_all();
+   for( auto& loop : _loops )
+      loop.wait();
+   _loops.clear();
+   _threads.clear();
+
+   std::lock_guard<std::mutex> lock( _mutex );
+   for( const auto& body : _queue )
+      spool( body );
+   _queue.clear();
+   _spool.flush();
+}
+
+void bulk_sender::run( uint16_t connection )
+{
+   CURL* curl = curl_easy_init();
+   std::string body;
+   fc::optional<spool_entry> spooled;
+   while( next_bulk( body, spooled ) )
+   {
+      bool sent = send( curl, body );
+      for( uint16_t attempt = 1; !sent && attempt <= _max_retries; ++attempt )
+      {
+         std::unique_lock<std::mutex> lock( _mutex );
+         if( _ready.wait_for( lock, std::chrono::seconds( std::min( 1 << attempt, 30 ) ),
+                              [this] () { return _stopping; } ) )
+            break;
+         lock.unlock();
+         sent = send( curl, body );
+      }
+      std::lock_guard<std::mutex> lock( _mutex );
+      if( !sent )
+      {
+         wlog( "elasticsearch: sender ${c} failed to send a bulk, spooling it", ("c",connection) );
+         spool( body );
+         _retry_after = fc::time_point::now() + fc::seconds( 30 );
+      }
+      // a spooled bulk that failed again was appended to the spool, so its old entry is done either way
+      if( spooled.valid() )
+         spooled_bulk_done( *spooled );
+   }
+   curl_easy_cleanup( curl );
+}
+
+bool bulk_sender::send( CURL* curl, const std::string& body )
+{
+   try
+   {
+      graphene::utilities::CurlRequest curl_request;
+      curl_request.handler = curl;
+      curl_request.url = _url + "_bulk";
+      curl_request.auth = _auth;
+      curl_request.type = "POST";
+      curl_request.query = body;
+
+      const auto response = graphene::utilities::doCurl( curl_request );
+      return graphene::utilities::handleBulkResponse( graphene::utilities::getResponseCode( curl ), response );
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "elasticsearch: unexpected bulk response: ${e}", ("e",e.to_string()) );
+      return false;
+   }
+}
+
+bool bulk_sender::next_bulk( std::string& body, fc::optional<spool_entry>& spooled )
+{
+   std::unique_lock<std::mutex> lock( _mutex );
+   spooled.reset();
+   while( !_stopping )
+   {
+      if( !_queue.empty() )
+      {
+         body = std::move( _queue.front() );
+         _queue.pop_front();
+         return true;
+      }
+      if( unspool( body, spooled ) )
+         return true;
+      // woken up by push() and stop(), and once a second to look at the spool again
+      _ready.wait_for( lock, std::chrono::seconds( 1 ) );
+   }
+   return false;
+}
+
+void bulk_sender::spool( const std::string& body )
+{
+   const uint64_t size = body.size();
+   _spool.clear();
+   _spool.seekp( _spool_size );
+   _spool.write( (const char*)&size, sizeof( size ) );
+   _spool.write( body.data(), body.size() );
+   _spool.flush();
+   if( !_spool )
+      elog( "elasticsearch: unable to write to the spool file ${f}, a bulk is lost", ("f",_spool_file) );
+   else
+      _spool_size += sizeof( size ) + size;
+}
+
+bool bulk_sender::unspool( std::string& body, fc::optional<spool_entry>& spooled )
+{
+   if( _spool_read_pos >= _spool_size || fc::time_point::now() < _retry_after )
+      return false;
+
+   uint64_t size = 0;
+   _spool.clear();
+   _spool.seekg( _spool_read_pos );
+   _spool.read( (char*)&size, sizeof( size ) );
+   if( _spool && _spool_read_pos + sizeof( size ) + size <= _spool_size )
+   {
+      body.resize( size );
+      _spool.read( &body[0], size );
+   }
+   if( !_spool || _spool_read_pos + sizeof( size ) + size > _spool_size )
+   {
+      elog( "elasticsearch: dropping the damaged rest of the spool file ${f}", ("f",_spool_file) );
+      // bulks spooled from now on overwrite the damaged part
+      _spool_size = _spool_read_pos;
+      if( _spool_taken.empty() )
+         reset_spool();
+      return false;
+   }
+
+   spooled = spool_entry{ _spool_generation, _spool_read_pos };
+   _spool_taken.insert( _spool_read_pos );
+   _spool_read_pos += sizeof( size ) + size;
+   return true;
+}
+
+void bulk_sender::spooled_bulk_done( const spool_entry& entry )
+{
+   // the spool was reset since the bulk was taken
+   if( entry.generation != _spool_generation )
+      return;
+   _spool_taken.erase( entry.pos );
+   const uint64_t sent_pos = _spool_taken.empty() ? _spool_read_pos : *_spool_taken.begin();
+   if( sent_pos == _spool_size )
+   {
+      // start over with an empty file once every bulk in it was sent
+      reset_spool();
+      return;
+   }
+   if( sent_pos > _spool_sent_pos )
+   {
+      _spool_sent_pos = sent_pos;
+      write_spool_header();
+   }
+}
+
+void bulk_sender::reset_spool()
+{
+   _spool.close();
+   _spool.open( _spool_file.generic_string(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc );
+   _spool_read_pos = _spool_sent_pos = _spool_size = spool_header_size;
+   _spool_taken.clear();
+   ++_spool_generation;
+   write_spool_header();
+}
+
+void bulk_sender::write_spool_header()
+{
+   _spool.clear();
+   _spool.seekp( 0 );
+   _spool.write( (const char*)&_spool_sent_pos, sizeof( _spool_sent_pos ) );
+   _spool.flush();
+   if( !_spool )
+      elog( "elasticsearch: unable to write to the spool file ${f}", ("f",_spool_file) );
+}
+
+} } // graphene::elasticsearch
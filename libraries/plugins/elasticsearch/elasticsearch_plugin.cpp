@@ -23,16 +23,26 @@
  */
 
 #include <graphene/elasticsearch/elasticsearch_plugin.hpp>
+#include <graphene/elasticsearch/bulk_sender.hpp>
 #include <graphene/chain/impacted.hpp>
 #include <graphene/chain/account_evaluator.hpp>
 #include <curl/curl.h>
 #include <graphene/utilities/elasticsearch.hpp>
+#include <fc/thread/parallel.hpp>
 
 namespace graphene { namespace elasticsearch {
 
 namespace detail
 {
 
+/// A document of the next bulk, serialized on the worker pool when the bulk is handed to the sender
+struct pending_document
+{
+   std::string index_name;
+   std::string id;
+   bulk_struct line;
+};
+
 class elasticsearch_plugin_impl
 {
    public:
@@ -42,6 +52,8 @@ class elasticsearch_plugin_impl
       virtual ~elasticsearch_plugin_impl();
 
       bool update_account_histories( const signed_block& b );
+      void send_pending();
+      void stop_sending();
 
       graphene::chain::database& database()
       {
@@ -59,18 +71,21 @@ class elasticsearch_plugin_impl
       std::string _elasticsearch_index_prefix = "crowdwiz-";
       bool _elasticsearch_operation_object = false;
       uint32_t _elasticsearch_start_es_after_block = 0;
+      uint16_t _elasticsearch_connections = 4;
+      uint32_t _elasticsearch_max_queued_bulks = 64;
+      uint16_t _elasticsearch_max_retries = 3;
+      fc::path _elasticsearch_spool_file;
       CURL *curl; // curl handler
-      vector <string> bulk_lines; //  vector of op lines
-      vector<std::string> prepare;
+      vector<pending_document> pending; // documents of the next bulk
+      std::shared_ptr<bulk_sender> sender;
+      vector<fc::future<void>> serializing; // bulks handed to the worker pool
 
-      graphene::utilities::ES es;
       uint32_t limit_documents;
       int16_t op_type;
       operation_history_struct os;
       block_struct bs;
       visitor_struct vs;
       bulk_struct bulk_line_struct;
-      std::string bulk_line;
       std::string index_name;
       bool is_sync = false;
    private:
@@ -88,7 +103,6 @@ class elasticsearch_plugin_impl
       void cleanObjects(const account_transaction_history_id_type& ath, const account_id_type& account_id);
       void createBulkLine(const account_transaction_history_object& ath);
       void prepareBulk(const account_transaction_history_id_type& ath_id);
-      void populateESstruct();
 };
 
 elasticsearch_plugin_impl::~elasticsearch_plugin_impl()
@@ -168,25 +182,56 @@ bool elasticsearch_plugin_impl::update_account_histories( const signed_block& b
       }
    }
    // we send bulk at end of block when we are in sync for better real time client experience
-   if(is_sync)
-   {
-      populateESstruct();
-      if(es.bulk_lines.size() > 0)
-      {
-         prepare.clear();
-         if(!graphene::utilities::SendBulk(std::move(es)))
-            return false;
-         else
-            bulk_lines.clear();
-      }
-   }
+   if(is_sync && pending.size() > 0)
+      send_pending();
 
-   if(bulk_lines.size() != limit_documents)
-      bulk_lines.reserve(limit_documents);
+   if(pending.capacity() < limit_documents)
+      pending.reserve(limit_documents);
 
    return true;
 }
 
+/**
+ * Hands the pending documents to the worker pool, which serializes them and queues the bulk in the sender.
+ * The chain thread neither serializes the bulk lines nor waits for elasticsearch.
+ */
+void elasticsearch_plugin_impl::send_pending()
+{
+   serializing.erase( std::remove_if( serializing.begin(), serializing.end(),
+                                      []( const fc::future<void>& f ) { return f.ready(); } ),
+                      serializing.end() );
+   auto docs = std::make_shared< vector<pending_document> >( std::move(pending) );
+   pending.clear();
+   auto to = sender;
+   serializing.push_back( fc::do_parallel( [docs,to] () {
+      vector<std::string> lines;
+      lines.reserve( docs->size() * 2 );
+      for( auto& doc : *docs )
+      {
+         fc::mutable_variant_object bulk_header;
+         bulk_header["_index"] = doc.index_name;
+         bulk_header["_type"] = "data";
+         bulk_header["_id"] = doc.id;
+         auto bulk = graphene::utilities::createBulk( bulk_header,
+                                                      fc::json::to_string(doc.line, fc::json::legacy_generator) );
+         std::move( bulk.begin(), bulk.end(), std::back_inserter(lines) );
+      }
+      to->push( std::move(lines) );
+   }, "elasticsearch_serialize" ) );
+}
+
+void elasticsearch_plugin_impl::stop_sending()
+{
+   if( !sender )
+      return;
+   if( pending.size() > 0 )
+      send_pending();
+   for( auto& f : serializing )
+      f.wait();
+   serializing.clear();
+   sender->stop();
+}
+
 void elasticsearch_plugin_impl::checkState(const fc::time_point_sec& block_time)
 {
    if((fc::time_point::now() - block_time) < fc::seconds(30))
@@ -288,14 +333,8 @@ bool elasticsearch_plugin_impl::add_elasticsearch( const account_id_type account
    }
    cleanObjects(ath.id, account_id);
 
-   if (curl && bulk_lines.size() >= limit_documents) { // we are in bulk time, ready to add data to elasticsearech
-      prepare.clear();
-      populateESstruct();
-      if(!graphene::utilities::SendBulk(std::move(es)))
-         return false;
-      else
-         bulk_lines.clear();
-   }
+   if (pending.size() >= limit_documents) // we are in bulk time, ready to add data to elasticsearech
+      send_pending();
 
    return true;
 }
@@ -342,20 +381,16 @@ void elasticsearch_plugin_impl::createBulkLine(const account_transaction_history
    bulk_line_struct.block_data = bs;
    if(_elasticsearch_visitor)
       bulk_line_struct.additional_data = vs;
-   bulk_line = fc::json::to_string(bulk_line_struct, fc::json::legacy_generator);
 }
 
 void elasticsearch_plugin_impl::prepareBulk(const account_transaction_history_id_type& ath_id)
 {
-   const std::string _id = fc::json::to_string(ath_id);
-   fc::mutable_variant_object bulk_header;
-   bulk_header["_index"] = index_name;
-   bulk_header["_type"] = "data";
-   bulk_header["_id"] = fc::to_string(ath_id.space_id) + "." + fc::to_string(ath_id.type_id) + "."
-                      + fc::to_string(ath_id.instance.value);
-   prepare = graphene::utilities::createBulk(bulk_header, std::move(bulk_line));
-   std::move(prepare.begin(), prepare.end(), std::back_inserter(bulk_lines));
-   prepare.clear();
+   pending.emplace_back();
+   pending_document& doc = pending.back();
+   doc.index_name = index_name;
+   doc.id = fc::to_string(ath_id.space_id) + "." + fc::to_string(ath_id.type_id) + "."
+          + fc::to_string(ath_id.instance.value);
+   doc.line = bulk_line_struct;
 }
 
 void elasticsearch_plugin_impl::cleanObjects(const account_transaction_history_id_type& ath_id, const account_id_type& account_id)
@@ -387,17 +422,6 @@ void elasticsearch_plugin_impl::cleanObjects(const account_transaction_history_i
    }
 }
 
-void elasticsearch_plugin_impl::populateESstruct()
-{
-   es.curl = curl;
-   es.bulk_lines = std::move(bulk_lines);
-   es.elasticsearch_url = _elasticsearch_node_url;
-   es.auth = _elasticsearch_basic_auth;
-   es.index_prefix = _elasticsearch_index_prefix;
-   es.endpoint = "";
-   es.query = "";
-}
-
 } // end namespace detail
 
 elasticsearch_plugin::elasticsearch_plugin() :
@@ -432,6 +456,10 @@ void elasticsearch_plugin::plugin_set_program_options(
          ("elasticsearch-index-prefix", boost::program_options::value<std::string>(), "Add a prefix to the index(crowdwiz-)")
          ("elasticsearch-operation-object", boost::program_options::value<bool>(), "Save operation as object(false)")
          ("elasticsearch-start-es-after-block", boost::program_options::value<uint32_t>(), "Start doing ES job after block(0)")
+         ("elasticsearch-connections", boost::program_options::value<uint16_t>(), "Number of bulk requests sent at the same time(4)")
+         ("elasticsearch-max-queued-bulks", boost::program_options::value<uint32_t>(), "Number of bulks kept in memory while elasticsearch is busy, more go to the spool file(64)")
+         ("elasticsearch-max-retries", boost::program_options::value<uint16_t>(), "Number of retries of a failed bulk before it is spooled(3)")
+         ("elasticsearch-spool-file", boost::program_options::value<std::string>(), "File of bulks waiting for elasticsearch(elasticsearch-spool in the data dir)")
          ;
    cfg.add(cli);
 }
@@ -470,6 +498,24 @@ void elasticsearch_plugin::plugin_initialize(const boost::program_options::varia
    if (options.count("elasticsearch-start-es-after-block")) {
       my->_elasticsearch_start_es_after_block = options["elasticsearch-start-es-after-block"].as<uint32_t>();
    }   
+   if (options.count("elasticsearch-connections")) {
+      my->_elasticsearch_connections = options["elasticsearch-connections"].as<uint16_t>();
+   }
+   if (options.count("elasticsearch-max-queued-bulks")) {
+      my->_elasticsearch_max_queued_bulks = options["elasticsearch-max-queued-bulks"].as<uint32_t>();
+   }
+   if (options.count("elasticsearch-max-retries")) {
+      my->_elasticsearch_max_retries = options["elasticsearch-max-retries"].as<uint16_t>();
+   }
+   if (options.count("elasticsearch-spool-file")) {
+      my->_elasticsearch_spool_file = options["elasticsearch-spool-file"].as<std::string>();
+   }
+   else
+      my->_elasticsearch_spool_file = app().data_dir() / "elasticsearch-spool";
+
+   my->sender = std::make_shared<bulk_sender>( my->_elasticsearch_node_url, my->_elasticsearch_basic_auth,
+                                               my->_elasticsearch_connections, my->_elasticsearch_max_queued_bulks,
+                                               my->_elasticsearch_max_retries, my->_elasticsearch_spool_file );
 }
 
 void elasticsearch_plugin::plugin_startup()
@@ -484,4 +530,9 @@ void elasticsearch_plugin::plugin_startup()
    ilog("elasticsearch ACCOUNT HISTORY: plugin_startup() begin");
 }
 
+void elasticsearch_plugin::plugin_shutdown()
+{
+   my->stop_sending();
+}
+
 } }
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2017 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <curl/curl.h>
+#include <fc/filesystem.hpp>
+#include <fc/optional.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/time.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace graphene { namespace elasticsearch {
+
+/**
+ *  Sends bulk requests to elasticsearch from a few threads of its own, each with its own CURL handle, so that
+ *  block application never waits on the network.
+ *
+ *  Bulks are queued in memory up to a limit. Beyond it, and for bulks that still fail after retrying, they are
+ *  appended to a spool file, which the senders drain whenever the queue runs empty. The file starts with the
+ *  offset up to which its bulks were sent, and is only emptied once all of them were. After a restart the bulks
+ *  from that offset on are sent, so those that were being sent go out twice, which elasticsearch tolerates since
+ *  every document has a fixed _id.
+ */
+class bulk_sender
+{
+   public:
+      bulk_sender( const std::string& url, const std::string& auth, uint16_t connections,
+                   uint32_t max_queued_bulks, uint16_t max_retries, const fc::path& spool_file );
+      ~bulk_sender();
+
+      /// Queues the lines of a bulk request, never blocks on the network. Can be called from any thread.
+      void push( std::vector<std::string>&& lines );
+
+      /// Stops the senders, moving the bulks still in memory to the spool file
+      void stop();
+
+   private:
+      /// Where a bulk taken from the spool file was
+      struct spool_entry
+      {
+         uint64_t generation;
+         uint64_t pos;
+      };
+
+      void run( uint16_t connection );
+      bool send( CURL* curl, const std::string& body );
+      bool next_bulk( std::string& body, fc::optional<spool_entry>& spooled );
+      void spool( const std::string& body );
+      bool unspool( std::string& body, fc::optional<spool_entry>& spooled );
+      void spooled_bulk_done( const spool_entry& entry );
+      void reset_spool();
+      void write_spool_header();
+
+      const std::string                         _url;
+      const std::string                         _auth;
+      const uint32_t                            _max_queued_bulks;
+      const uint16_t                            _max_retries;
+      const fc::path                            _spool_file;
+
+      std::mutex                                _mutex;
+      std::condition_variable                   _ready;
+      std::deque<std::string>                   _queue;
+      bool                                      _stopping = false;
+      std::fstream                              _spool;
+      uint64_t                                  _spool_read_pos = 0;
+      /// The bulks before this offset were sent, it is kept in the header of the file
+      uint64_t                                  _spool_sent_pos = 0;
+      uint64_t                                  _spool_size = 0;
+      /// Offsets of the spooled bulks that are being sent
+      std::set<uint64_t>                        _spool_taken;
+      /// Counts resets of the spool, so that bulks taken before one are not matched to the new file
+      uint64_t                                  _spool_generation = 0;
+      /// Spooled bulks are not taken before this time when the last attempt to send one failed
+      fc::time_point                            _retry_after;
+
+      std::vector<std::unique_ptr<fc::thread>>  _threads;
+      std::vector<fc::future<void>>             _loops;
+};
+
+} } // graphene::elasticsearch
@@ -46,7 +46,7 @@ class es_objects_plugin_impl
       {  curl = curl_easy_init(); }
       virtual ~es_objects_plugin_impl();
 
-      bool index_database( const vector<object_id_type>& ids, std::string action);
+      bool index_database( const vector<object_id_type>& ids, const vector<const object*>& objs, std::string action);
       void remove_from_database( object_id_type id, std::string index);
 
       es_objects_plugin& _self;
@@ -76,7 +76,7 @@ class es_objects_plugin_impl
       void prepareTemplate(T blockchain_object, string index_name);
 };
 
-bool es_objects_plugin_impl::index_database( const vector<object_id_type>& ids, std::string action)
+bool es_objects_plugin_impl::index_database( const vector<object_id_type>& ids, const vector<const object*>& objs, std::string action)
 {
    graphene::chain::database &db = _self.database();
 
@@ -93,9 +93,10 @@ bool es_objects_plugin_impl::index_database( const vector<object_id_type>& ids,
          limit_documents = _es_objects_bulk_replay;
 
 
-      for (auto const &value: ids) {
+      for (size_t i = 0; i < ids.size(); ++i) {
+         const object_id_type& value = ids[i];
+         const object* obj = objs[i];
          if (value.is<proposal_object>() && _es_objects_proposals) {
-            auto obj = db.find_object(value);
             auto p = static_cast<const proposal_object *>(obj);
             if (p != nullptr) {
                if (action == "delete")
@@ -104,7 +105,6 @@ bool es_objects_plugin_impl::index_database( const vector<object_id_type>& ids,
                   prepareTemplate<proposal_object>(*p, "proposal");
             }
          } else if (value.is<account_object>() && _es_objects_accounts) {
-            auto obj = db.find_object(value);
             auto a = static_cast<const account_object *>(obj);
             if (a != nullptr) {
                if (action == "delete")
@@ -113,7 +113,6 @@ bool es_objects_plugin_impl::index_database( const vector<object_id_type>& ids,
                   prepareTemplate<account_object>(*a, "account");
             }
          } else if (value.is<asset_object>() && _es_objects_assets) {
-            auto obj = db.find_object(value);
             auto a = static_cast<const asset_object *>(obj);
             if (a != nullptr) {
                if (action == "delete")
@@ -122,7 +121,6 @@ bool es_objects_plugin_impl::index_database( const vector<object_id_type>& ids,
                   prepareTemplate<asset_object>(*a, "asset");
             }
          } else if (value.is<account_balance_object>() && _es_objects_balances) {
-            auto obj = db.find_object(value);
             auto b = static_cast<const account_balance_object *>(obj);
             if (b != nullptr) {
                if (action == "delete")
@@ -131,7 +129,6 @@ bool es_objects_plugin_impl::index_database( const vector<object_id_type>& ids,
                   prepareTemplate<account_balance_object>(*b, "balance");
             }
          } else if (value.is<limit_order_object>() && _es_objects_limit_orders) {
-            auto obj = db.find_object(value);
             auto l = static_cast<const limit_order_object *>(obj);
             if (l != nullptr) {
                if (action == "delete")
@@ -140,7 +137,6 @@ bool es_objects_plugin_impl::index_database( const vector<object_id_type>& ids,
                   prepareTemplate<limit_order_object>(*l, "limitorder");
             }
          } else if (value.is<asset_bitasset_data_object>() && _es_objects_asset_bitasset) {
-            auto obj = db.find_object(value);
             auto ba = static_cast<const asset_bitasset_data_object *>(obj);
             if (ba != nullptr) {
                if (action == "delete")
@@ -262,23 +258,19 @@ void es_objects_plugin::plugin_set_program_options(
 
 void es_objects_plugin::plugin_initialize(const boost::program_options::variables_map& options)
 {
-   database().new_objects.connect([&]( const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts ) {
-      if(!my->index_database(ids, "create"))
+   database().object_changes.connect([this]( const std::shared_ptr<const graphene::chain::object_change_set>& changes ) {
+      if(!changes->new_ids.empty() && !my->index_database(changes->new_ids, changes->new_objects, "create"))
       {
          FC_THROW_EXCEPTION(graphene::chain::plugin_exception, "Error creating object from ES database, we are going to keep trying.");
       }
-   });
-   database().changed_objects.connect([&]( const vector<object_id_type>& ids, const flat_set<account_id_type>& impacted_accounts ) {
-      if(!my->index_database(ids, "update"))
+      if(!changes->changed_ids.empty() && !my->index_database(changes->changed_ids, changes->changed_objects, "update"))
       {
          FC_THROW_EXCEPTION(graphene::chain::plugin_exception, "Error updating object from ES database, we are going to keep trying.");
       }
-   });
-   database().removed_objects.connect([this](const vector<object_id_type>& ids, const vector<const object*>& objs, const flat_set<account_id_type>& impacted_accounts) {
-       if(!my->index_database(ids, "delete"))
-       {
-          FC_THROW_EXCEPTION(graphene::chain::plugin_exception, "Error deleting object from ES database, we are going to keep trying.");
-       }
+      if(!changes->removed_ids.empty() && !my->index_database(changes->removed_ids, changes->removed_objects, "delete"))
+      {
+         FC_THROW_EXCEPTION(graphene::chain::plugin_exception, "Error deleting object from ES database, we are going to keep trying.");
+      }
    });
 
 
@@ -26,10 +26,41 @@
 #include <graphene/app/plugin.hpp>
 #include <graphene/chain/database.hpp>
 
+#include <fc/thread/future.hpp>
+#include <fc/thread/thread.hpp>
 #include <fc/time.hpp>
 
 namespace graphene { namespace snapshot_plugin {
 
+/** Describes one index file of a binary snapshot */
+struct snapshot_index_entry
+{
+   uint8_t  space   = 0;
+   uint8_t  type    = 0;
+   uint64_t objects = 0;
+   uint64_t bytes   = 0;
+};
+
+/**
+ *  Written as manifest.json next to the index files of a binary snapshot. The index files have the format
+ *  of the object_database, so that a snapshot can be installed as the state of a new node, see snapshot-load.
+ */
+struct snapshot_manifest
+{
+   graphene::chain::chain_id_type       chain_id;
+   std::string                          db_version;
+   uint32_t                             head_block_num = 0;
+   graphene::chain::block_id_type       head_block_id;
+   fc::time_point_sec                   head_block_time;
+   std::vector<snapshot_index_entry>    indexes;
+   /// The blocks from the last irreversible block to the head block are packed in the file "blocks", they are
+   /// stored in the block log of a bootstrapped node so that it can tell its peers where it is
+   uint32_t                             first_block_num = 0;
+   uint64_t                             blocks_bytes = 0;
+   /// The last irreversible block when the snapshot was created, a snapshot of a later block is not loaded
+   uint32_t                             last_irreversible_block_num = 0;
+};
+
 class snapshot_plugin : public graphene::app::plugin {
    public:
       ~snapshot_plugin() {}
@@ -48,10 +79,26 @@ class snapshot_plugin : public graphene::app::plugin {
 
    private:
        void check_snapshot( const graphene::chain::signed_block& b);
+       void check_irreversible_snapshot();
+       void create_irreversible_snapshot();
+       void create_snapshot( const graphene::chain::signed_block& b );
+       void load_snapshot( const fc::path& src );
 
        uint32_t           snapshot_block = -1, last_block = 0;
        fc::time_point_sec snapshot_time = fc::time_point_sec::maximum(), last_time = fc::time_point_sec(1);
        fc::path           dest;
+       bool               binary = false;
+       /// Set when a binary snapshot is due but could not be created yet
+       bool               snapshot_pending = false;
+       /// Assembles the JSON snapshot from its per-index parts after the chain has moved on
+       std::unique_ptr<fc::thread> writer;
+       /// The JSON writer task, or the chain thread task creating a binary snapshot
+       fc::future<void>   written;
 };
 
 } } //graphene::snapshot_plugin
+
+FC_REFLECT( graphene::snapshot_plugin::snapshot_index_entry, (space)(type)(objects)(bytes) )
+FC_REFLECT( graphene::snapshot_plugin::snapshot_manifest,
+            (chain_id)(db_version)(head_block_num)(head_block_id)(head_block_time)(indexes)
+            (first_block_num)(blocks_bytes)(last_irreversible_block_num) )
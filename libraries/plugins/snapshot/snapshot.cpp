@@ -23,9 +23,15 @@
  */
 #include <graphene/snapshot/snapshot.hpp>
 
+#include <graphene/chain/block_database.hpp>
 #include <graphene/chain/database.hpp>
 
 #include <fc/io/fstream.hpp>
+#include <fc/io/json.hpp>
+#include <fc/thread/parallel.hpp>
+
+#include <fstream>
+#include <future>
 
 using namespace graphene::snapshot_plugin;
 using std::string;
@@ -36,6 +42,8 @@ namespace bpo = boost::program_options;
 static const char* OPT_BLOCK_NUM  = "snapshot-at-block";
 static const char* OPT_BLOCK_TIME = "snapshot-at-time";
 static const char* OPT_DEST       = "snapshot-to";
+static const char* OPT_FORMAT     = "snapshot-format";
+static const char* OPT_LOAD       = "snapshot-load";
 
 void snapshot_plugin::plugin_set_program_options(
    boost::program_options::options_description& command_line_options,
@@ -44,7 +52,12 @@ void snapshot_plugin::plugin_set_program_options(
    command_line_options.add_options()
          (OPT_BLOCK_NUM, bpo::value<uint32_t>(), "Block number after which to do a snapshot")
          (OPT_BLOCK_TIME, bpo::value<string>(), "Block time (ISO format) after which to do a snapshot")
-         (OPT_DEST, bpo::value<string>(), "Pathname of JSON file where to store the snapshot")
+         (OPT_DEST, bpo::value<string>(), "Pathname of JSON file, or directory of a binary snapshot, where to store the snapshot")
+         (OPT_FORMAT, bpo::value<string>()->default_value("json"),
+          "Snapshot format: json (one object per line) or binary (object_database files and a manifest.json). "
+          "A binary snapshot is taken once the given block is irreversible and shows the last irreversible block")
+         (OPT_LOAD, bpo::value<string>(),
+          "Directory of a binary snapshot to start a node with an empty data directory from")
          ;
    config_file_options.add(command_line_options);
 }
@@ -63,6 +76,9 @@ void snapshot_plugin::plugin_initialize(const boost::program_options::variables_
 { try {
    ilog("snapshot plugin: plugin_initialize() begin");
 
+   if( options.count(OPT_LOAD) )
+      load_snapshot( options[OPT_LOAD].as<std::string>() );
+
    if( options.count(OPT_BLOCK_NUM) || options.count(OPT_BLOCK_TIME) )
    {
       FC_ASSERT( options.count(OPT_DEST), "Must specify snapshot-to in addition to snapshot-at-block or snapshot-at-time!" );
@@ -71,6 +87,11 @@ void snapshot_plugin::plugin_initialize(const boost::program_options::variables_
          snapshot_block = options[OPT_BLOCK_NUM].as<uint32_t>();
       if( options.count(OPT_BLOCK_TIME) )
          snapshot_time = fc::time_point_sec::from_iso_string( options[OPT_BLOCK_TIME].as<std::string>() );
+      const std::string format = options[OPT_FORMAT].as<std::string>();
+      FC_ASSERT( format == "json" || format == "binary", "Unknown snapshot-format ${f}", ("f",format) );
+      binary = ( format == "binary" );
+      if( !binary )
+         writer.reset( new fc::thread( "snapshot_writer" ) );
       database().applied_block.connect( [&]( const graphene::chain::signed_block& b ) {
          check_snapshot( b );
       });
@@ -82,47 +103,311 @@ void snapshot_plugin::plugin_initialize(const boost::program_options::variables_
 
 void snapshot_plugin::plugin_startup() {}
 
-void snapshot_plugin::plugin_shutdown() {}
+void snapshot_plugin::plugin_shutdown()
+{
+   if( written.valid() )
+      written.wait();
+}
 
-static void create_snapshot( const graphene::chain::database& db, const fc::path& dest )
+/**
+ *  Serializes every index on the worker pool while the block-apply thread waits, so that all of them show the
+ *  state after the same block. The thread is blocked on std::futures instead of fc futures: waiting on an fc
+ *  future would let other tasks of this thread modify the state in between.
+ */
+void snapshot_plugin::create_snapshot( const graphene::chain::signed_block& b )
 {
    ilog("snapshot plugin: creating snapshot");
-   fc::ofstream out;
+   const graphene::chain::database& db = database();
+   const auto start = fc::time_point::now();
+
+   vector<const graphene::db::index*> indexes;
+   for( uint32_t space_id = 0; space_id < 256; space_id++ )
+      for( uint32_t type_id = 0; type_id < 256; type_id++ )
+      {
+         try
+         {
+            indexes.push_back( &db.get_index( (uint8_t)space_id, (uint8_t)type_id ) );
+         }
+         catch (fc::assert_exception& e)
+         {
+            continue;
+         }
+      }
+
+   // the JSON snapshot is written as one part per index, which are joined by the writer thread afterwards
+   if( !binary && written.valid() )
+      written.wait();
+   const fc::path parts = dest.generic_string() + ".parts";
    try
    {
-      out.open( dest );
+      if( binary )
+      {
+         fc::remove_all( dest / "manifest.json" );
+         fc::create_directories( dest );
+      }
+      else
+      {
+         fc::remove_all( parts );
+         fc::create_directories( parts );
+      }
    }
    catch ( fc::exception& e )
    {
       wlog( "Failed to open snapshot destination: ${ex}", ("ex",e) );
       return;
    }
-   for( uint32_t space_id = 0; space_id < 256; space_id++ )
-      for( uint32_t type_id = 0; type_id < 256; type_id++ )
-      {
-         try
-         {
-            db.get_index( (uint8_t)space_id, (uint8_t)type_id );
+
+   const fc::path base = binary ? dest : parts;
+   auto part_path = [base]( const snapshot_index_entry& entry ) {
+      return base / fc::to_string( entry.space ) / fc::to_string( entry.type );
+   };
+
+   vector<snapshot_index_entry> entries( indexes.size() );
+   vector<std::future<void>> workers;
+   workers.reserve( indexes.size() );
+   for( size_t i = 0; i < indexes.size(); ++i )
+   {
+      const graphene::db::index& index = *indexes[i];
+      snapshot_index_entry& entry = entries[i];
+      entry.space = index.object_space_id();
+      entry.type = index.object_type_id();
+      const fc::path path = part_path( entry );
+      fc::create_directories( path.parent_path() );
+      auto done = std::make_shared<std::promise<void>>();
+      workers.push_back( done->get_future() );
+      const bool as_binary = binary;
+      fc::do_parallel( [&index,&entry,path,as_binary,done] () {
+         try {
+            if( as_binary )
+            {
+               index.inspect_all_objects( [&entry]( const graphene::db::object& ) { ++entry.objects; } );
+               // save() only reads the index, it just is not declared const
+               const_cast<graphene::db::index&>( index ).save( path );
+            }
+            else
+            {
+               std::ofstream out( path.generic_string(), std::ofstream::binary | std::ofstream::trunc );
+               FC_ASSERT( out, "Unable to write ${p}", ("p",path) );
+               index.inspect_all_objects( [&out,&entry]( const graphene::db::object& o ) {
+                  out << fc::json::to_string( o.to_variant() ) << '\n';
+                  ++entry.objects;
+               });
+            }
+            entry.bytes = fc::file_size( path );
+            done->set_value();
+         } catch( ... ) {
+            done->set_exception( std::current_exception() );
          }
-         catch (fc::assert_exception& e)
+      });
+   }
+   try
+   {
+      for( auto& worker : workers )
+         worker.get();
+   }
+   catch( const fc::exception& e )
+   {
+      elog( "Failed to create snapshot: ${ex}", ("ex",e.to_detail_string()) );
+      return;
+   }
+   catch( const std::exception& e )
+   {
+      elog( "Failed to create snapshot: ${ex}", ("ex",e.what()) );
+      return;
+   }
+
+   uint64_t objects = 0;
+   for( const auto& entry : entries )
+      objects += entry.objects;
+   ilog( "snapshot plugin: serialized ${n} objects of ${i} indexes at block ${b} in ${t} ms",
+         ("n",objects)("i",entries.size())("b",b.block_num())
+         ("t",(fc::time_point::now() - start).count() / 1000) );
+
+   if( binary )
+   {
+      snapshot_manifest manifest;
+      manifest.chain_id = db.get_chain_id();
+      manifest.db_version = GRAPHENE_CURRENT_DB_VERSION;
+      manifest.head_block_num = b.block_num();
+      manifest.head_block_id = b.id();
+      manifest.head_block_time = b.timestamp;
+      // binary snapshots are only created by create_irreversible_snapshot()
+      manifest.last_irreversible_block_num = b.block_num();
+      manifest.indexes = std::move( entries );
+      manifest.first_block_num = std::max<uint32_t>( 1, db.get_dynamic_global_properties().last_irreversible_block_num );
+      try
+      {
+         vector<graphene::chain::signed_block> blocks;
+         blocks.reserve( b.block_num() - manifest.first_block_num + 1 );
+         for( uint32_t num = manifest.first_block_num; num < b.block_num(); ++num )
          {
-            continue;
+            auto block = db.fetch_block_by_number( num );
+            FC_ASSERT( block.valid(), "Block ${n} is neither in the block log nor in the fork database", ("n",num) );
+            blocks.push_back( std::move( *block ) );
          }
-         auto& index = db.get_index( (uint8_t)space_id, (uint8_t)type_id );
-         index.inspect_all_objects( [&out]( const graphene::db::object& o ) {
-            out << fc::json::to_string( o.to_variant() ) << '\n';
-         });
+         blocks.push_back( b );
+         const fc::path blocks_path = dest / "blocks";
+         std::ofstream out( blocks_path.generic_string(), std::ofstream::binary | std::ofstream::trunc );
+         const auto packed = fc::raw::pack( blocks );
+         out.write( packed.data(), packed.size() );
+         out.close();
+         FC_ASSERT( out, "Unable to write ${p}", ("p",blocks_path) );
+         manifest.blocks_bytes = packed.size();
+      }
+      catch( const fc::exception& e )
+      {
+         elog( "Failed to create snapshot: ${ex}", ("ex",e.to_detail_string()) );
+         return;
+      }
+      // written last, so that a manifest only exists next to complete index files
+      fc::json::save_to_file( manifest, dest / "manifest.json", true, fc::json::stringify_large_ints_and_doubles,
+                              GRAPHENE_MAX_NESTED_OBJECTS );
+      ilog("snapshot plugin: created snapshot");
+      return;
+   }
+
+   const fc::path out_path = dest;
+   written = writer->async( [entries,parts,out_path,part_path] () {
+      std::ofstream out( out_path.generic_string(), std::ofstream::binary | std::ofstream::trunc );
+      if( !out )
+      {
+         wlog( "Failed to open snapshot destination ${d}", ("d",out_path) );
+         return;
       }
-   out.close();
-   ilog("snapshot plugin: created snapshot");
+      for( const auto& entry : entries )
+      {
+         std::ifstream in( part_path( entry ).generic_string(), std::ifstream::binary );
+         if( entry.objects > 0 )
+            out << in.rdbuf();
+      }
+      out.close();
+      fc::remove_all( parts );
+      ilog("snapshot plugin: created snapshot");
+   }, "snapshot_write" );
 }
 
+/**
+ *  Installs the index files of a binary snapshot as the object_database of a data directory without chain state,
+ *  and stores the blocks from the last irreversible block to the head block of the snapshot in its block log.
+ *  The node then opens the snapshot state and syncs the blocks after it from its peers, instead of replaying the
+ *  chain from genesis. It cannot serve the blocks before the snapshot to its peers.
+ */
+void snapshot_plugin::load_snapshot( const fc::path& src )
+{ try {
+   const auto manifest = fc::json::from_file( src / "manifest.json", fc::json::legacy_parser,
+                                              GRAPHENE_MAX_NESTED_OBJECTS )
+                            .as<snapshot_manifest>( GRAPHENE_MAX_NESTED_OBJECTS );
+   FC_ASSERT( manifest.db_version == GRAPHENE_CURRENT_DB_VERSION,
+              "Snapshot ${s} has database version ${v}, this node uses ${n}",
+              ("s",src)("v",manifest.db_version)("n",GRAPHENE_CURRENT_DB_VERSION) );
+   // the node starts without undo history, it could not leave the fork of a reversible head block
+   FC_ASSERT( manifest.head_block_num <= manifest.last_irreversible_block_num,
+              "Snapshot ${s} shows the reversible block ${b}, the last irreversible block was ${i}",
+              ("s",src)("b",manifest.head_block_num)("i",manifest.last_irreversible_block_num) );
+
+   FC_ASSERT( fc::exists( src / "blocks" ) && fc::file_size( src / "blocks" ) == manifest.blocks_bytes,
+              "Snapshot file ${f} is missing or has the wrong size", ("f",src / "blocks") );
+   std::string packed_blocks;
+   fc::read_file_contents( src / "blocks", packed_blocks );
+   const auto blocks = fc::raw::unpack< vector<graphene::chain::signed_block> >( packed_blocks.data(),
+                                                                                 packed_blocks.size() );
+   FC_ASSERT( !blocks.empty() && blocks.back().id() == manifest.head_block_id,
+              "The blocks of snapshot ${s} do not end with its head block", ("s",src) );
+   for( size_t i = 0; i < blocks.size(); ++i )
+      FC_ASSERT( blocks[i].block_num() == manifest.first_block_num + i
+                 && ( i == 0 || blocks[i].previous == blocks[i-1].id() ),
+                 "The blocks of snapshot ${s} are not a chain from block ${n}", ("s",src)("n",manifest.first_block_num) );
+
+   const fc::path chain_dir = app().data_dir() / "blockchain";
+   if( fc::exists( chain_dir / "object_database" ) || fc::exists( chain_dir / "database" ) )
+   {
+      wlog( "Not loading snapshot ${s}, ${d} already contains a chain state", ("s",src)("d",chain_dir) );
+      return;
+   }
+   ilog( "snapshot plugin: loading snapshot of block ${b} from ${s}", ("b",manifest.head_block_num)("s",src) );
+
+   // copied into place in one go, so that an interrupted load does not leave a partial state behind
+   const fc::path staging = chain_dir / "object_database.tmp";
+   fc::remove_all( staging );
+   for( const auto& entry : manifest.indexes )
+   {
+      const fc::path relative = fc::path( fc::to_string( entry.space ) ) / fc::to_string( entry.type );
+      FC_ASSERT( fc::exists( src / relative ) && fc::file_size( src / relative ) == entry.bytes,
+                 "Snapshot file ${f} is missing or has the wrong size", ("f",src / relative) );
+      fc::create_directories( ( staging / relative ).parent_path() );
+      fc::copy( src / relative, staging / relative );
+   }
+   fc::rename( staging, chain_dir / "object_database" );
+
+   std::ofstream version_file( ( chain_dir / "db_version" ).generic_string().c_str(),
+                               std::ios::out | std::ios::binary | std::ios::trunc );
+   version_file.write( manifest.db_version.c_str(), manifest.db_version.size() );
+   version_file.close();
+
+   graphene::chain::block_database block_log;
+   block_log.open( chain_dir / "database" / "block_num_to_block" );
+   for( const auto& block : blocks )
+      block_log.store( block.id(), block );
+   block_log.close();
+   ilog( "snapshot plugin: loaded snapshot" );
+} FC_CAPTURE_AND_RETHROW( (src) ) }
+
 void snapshot_plugin::check_snapshot( const graphene::chain::signed_block& b )
 { try {
+    if( binary )
+    {
+       check_irreversible_snapshot();
+       return;
+    }
     uint32_t current_block = b.block_num();
     if( (last_block < snapshot_block && snapshot_block <= current_block)
            || (last_time < snapshot_time && snapshot_time <= b.timestamp) )
-       create_snapshot( database(), dest );
+       create_snapshot( b );
     last_block = current_block;
     last_time = b.timestamp;
 } FC_LOG_AND_RETHROW() }
+
+/**
+ *  A binary snapshot is due once the block or time it is configured for is irreversible. It cannot be taken while
+ *  the block is applied, so it is scheduled on the chain thread, and tried again with the next blocks while the
+ *  undo history does not reach back to the last irreversible block yet.
+ */
+void snapshot_plugin::check_irreversible_snapshot()
+{
+   const graphene::chain::database& db = database();
+   const uint32_t irreversible = db.get_dynamic_global_properties().last_irreversible_block_num;
+   if( !snapshot_pending && irreversible > last_block )
+   {
+      fc::time_point_sec irreversible_time = last_time;
+      if( snapshot_time != fc::time_point_sec::maximum() )
+      {
+         const auto block = db.fetch_block_by_number( irreversible );
+         if( block.valid() )
+            irreversible_time = block->timestamp;
+      }
+      snapshot_pending = ( last_block < snapshot_block && snapshot_block <= irreversible )
+                         || ( last_time < snapshot_time && snapshot_time <= irreversible_time );
+      last_block = irreversible;
+      last_time = irreversible_time;
+   }
+   if( snapshot_pending && !( written.valid() && !written.ready() ) )
+      written = fc::async( [this] () { create_irreversible_snapshot(); }, "snapshot" );
+}
+
+void snapshot_plugin::create_irreversible_snapshot()
+{
+   graphene::chain::database& db = database();
+   try
+   {
+      db.with_irreversible_state( [this,&db] () {
+         const auto head = db.fetch_block_by_id( db.head_block_id() );
+         FC_ASSERT( head.valid(), "Block ${id} is not in the block log", ("id",db.head_block_id()) );
+         create_snapshot( *head );
+      });
+      snapshot_pending = false;
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "Not creating the snapshot yet: ${e}", ("e",e.to_detail_string()) );
+   }
+}
@@ -0,0 +1,781 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * Reproducible block application benchmark.
+ *
+ * Builds a synthetic chain from a fixed genesis: a bank account registers a referral tree of accounts and funds
+ * them, then every scenario fills blocks with one kind of CrowdWiz operation. Blocks are produced by one database
+ * and pushed, fully validated, into a second database opened from the same genesis; only the latter is timed.
+ * Everything is deterministic, so two runs with the same options apply byte-identical blocks.
+ */
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/block_summary_object.hpp>
+#include <graphene/chain/gamezone_object.hpp>
+#include <graphene/chain/greatrace_object.hpp>
+#include <graphene/chain/global_property_object.hpp>
+#include <graphene/chain/hardfork.hpp>
+#include <graphene/chain/protocol/fee_schedule.hpp>
+
+#include <fc/bitutil.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/json.hpp>
+#include <fc/optional.hpp>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace graphene::chain;
+namespace bpo = boost::program_options;
+
+namespace {
+
+   const uint32_t  genesis_time = 1700000000; // after all time based hardforks, a multiple of the block interval
+   // the chain starts after this block, past the hardforks that are gated on block numbers
+   const uint32_t  first_block_num = HARDFORK_CORE_1482_BLOCK_NUM + 1;
+   const share_type cwd = GRAPHENE_BLOCKCHAIN_PRECISION;
+
+   struct step_result
+   {
+      string   name;
+      uint64_t ops = 0;
+      uint32_t blocks = 0;
+      double   seconds = 0;
+      double   ops_per_second = 0;
+      uint64_t block_p50_us = 0;
+      uint64_t block_max_us = 0;
+      uint64_t op_p50_ns = 0;
+      uint64_t op_p99_ns = 0;
+      uint64_t rss_kb = 0;
+   };
+
+   struct operation_name_visitor
+   {
+      typedef string result_type;
+      template<typename Op>
+      string operator()( const Op& )const
+      {
+         const string name = fc::get_typename<Op>::name();
+         return name.substr( name.rfind( ':' ) + 1 );
+      }
+   };
+
+   /// Resident set size of this process in KiB
+   uint64_t resident_set_kb()
+   {
+      std::ifstream status( "/proc/self/status" );
+      string line;
+      while( std::getline( status, line ) )
+         if( boost::starts_with( line, "VmRSS:" ) )
+            return std::stoull( line.substr( 6 ) );
+      struct rusage usage;
+      getrusage( RUSAGE_SELF, &usage );
+      return usage.ru_maxrss;
+   }
+
+   class chain_benchmark
+   {
+      public:
+         struct options
+         {
+            uint32_t      accounts = 2000;
+            uint32_t      fanout = 3;
+            uint32_t      ops_per_block = 200;
+            bool          skip_signatures = false;
+            std::set<string> scenarios;
+            fc::path      data_dir;
+         };
+
+         explicit chain_benchmark( const options& o );
+         ~chain_benchmark();
+
+         vector<step_result> run();
+
+      private:
+         /// One measured phase: next() yields operations until it returns an empty optional
+         struct step
+         {
+            string                                          name;
+            std::function<optional<operation>()>            next;
+            std::function<void( const operation_result& )>  on_result;
+         };
+
+         genesis_state_type make_genesis()const;
+         bool               wants( const string& scenario )const;
+         operation_result   push( operation op );
+         step_result        run_step( const step& s );
+         void               produce_block( vector<uint64_t>& block_us );
+         /// Applies the same direct state change to both databases, for state that no operation can create
+         void               seed( const std::function<void( database& )>& f );
+
+         /// A step issuing one operation per index in [0, count)
+         step               per_index( const string& name, uint32_t count,
+                                       const std::function<operation( uint32_t )>& make,
+                                       const std::function<void( uint32_t, const operation_result& )>& on_result = {} );
+
+         void add_setup_steps( vector<step>& steps );
+         void add_scenario_steps( vector<step>& steps );
+         /// Times database::modify()/create() against the type erased index::modify()/create() on the validator
+         vector<step_result> run_mutation_benchmark();
+
+         options                  _options;
+         fc::ecc::private_key     _key;
+         public_key_type          _pub;
+         fc::path                 _data_dir;
+         std::unique_ptr<fc::temp_directory> _temp_dir;
+         database                 _producer;
+         database                 _validator;
+         uint64_t                 _trx_count = 0;
+
+         account_id_type          _bank;
+         vector<account_id_type>  _accounts;
+   };
+
+   chain_benchmark::chain_benchmark( const options& o )
+      : _options( o ),
+        _key( fc::ecc::private_key::regenerate( fc::sha256::hash( string( "crowdwiz-benchmark" ) ) ) ),
+        _pub( _key.get_public_key() )
+   {
+      if( _options.data_dir == fc::path() )
+      {
+         _temp_dir.reset( new fc::temp_directory() );
+         _data_dir = _temp_dir->path();
+      }
+      else
+      {
+         _data_dir = _options.data_dir;
+         fc::remove_all( _data_dir / "producer" );
+         fc::remove_all( _data_dir / "validator" );
+      }
+
+      const genesis_state_type genesis = make_genesis();
+      _producer.open( _data_dir / "producer", [&genesis]{ return genesis; }, GRAPHENE_CURRENT_DB_VERSION );
+      _validator.open( _data_dir / "validator", [&genesis]{ return genesis; }, GRAPHENE_CURRENT_DB_VERSION );
+      _validator.enable_profiling( true, 0 );
+      seed( [] ( database& db ) {
+         block_id_type head_id;
+         head_id._hash[0] = fc::endian_reverse_u32( first_block_num );
+         db.modify( db.get_dynamic_global_properties(), [&head_id]( dynamic_global_property_object& dgp ) {
+            dgp.head_block_number = first_block_num;
+            dgp.head_block_id = head_id;
+            dgp.last_irreversible_block_num = first_block_num;
+         });
+         // the first transactions refer to the head block for TaPoS
+         db.modify( block_summary_id_type( first_block_num & 0xffff )( db ), [&head_id]( block_summary_object& summary ) {
+            summary.block_id = head_id;
+         });
+      });
+      _bank = _producer.get_index_type<account_index>().indices().get<by_name>().find( "bank" )->id;
+   }
+
+   chain_benchmark::~chain_benchmark()
+   {
+      _producer.close();
+      _validator.close();
+   }
+
+   genesis_state_type chain_benchmark::make_genesis()const
+   {
+      genesis_state_type genesis;
+      genesis.initial_timestamp = fc::time_point_sec( genesis_time );
+      genesis.initial_parameters.maximum_block_size = 10 * GRAPHENE_DEFAULT_MAX_BLOCK_SIZE;
+      genesis.initial_parameters.current_fees = fee_schedule::get_default();
+      genesis.initial_active_witnesses = GRAPHENE_DEFAULT_MIN_WITNESS_COUNT;
+      for( uint32_t i = 0; i < genesis.initial_active_witnesses; ++i )
+      {
+         const string name = "init" + std::to_string( i );
+         genesis.initial_accounts.emplace_back( name, _pub, _pub, true );
+         genesis.initial_committee_candidates.push_back( { name } );
+         genesis.initial_witness_candidates.push_back( { name, _pub } );
+      }
+      genesis.initial_accounts.emplace_back( "bank", _pub, _pub, true );
+      // leave half of the supply unissued, staking rewards are minted against max_supply
+      genesis.initial_balances.push_back( { address( _pub ), GRAPHENE_SYMBOL, GRAPHENE_MAX_SHARE_SUPPLY / 2 } );
+      genesis.initial_chain_id = fc::sha256::hash( string( "crowdwiz-benchmark" ) );
+      return genesis;
+   }
+
+   bool chain_benchmark::wants( const string& scenario )const
+   {
+      return _options.scenarios.empty() || _options.scenarios.count( scenario ) > 0;
+   }
+
+   operation_result chain_benchmark::push( operation op )
+   {
+      _producer.current_fee_schedule().set_fee( op );
+      signed_transaction trx;
+      trx.operations.push_back( op );
+      trx.set_reference_block( _producer.head_block_id() );
+      // vary the expiration so that otherwise identical transactions get distinct ids
+      trx.set_expiration( _producer.head_block_time() + fc::seconds( 60 + _trx_count++ % 600 ) );
+      trx.sign( _key, _producer.get_chain_id() );
+      return _producer.push_transaction( trx ).operation_results.front();
+   }
+
+   void chain_benchmark::produce_block( vector<uint64_t>& block_us )
+   {
+      const signed_block block = _producer.generate_block( _producer.get_slot_time( 1 ),
+                                                           _producer.get_scheduled_witness( 1 ), _key,
+                                                           database::skip_nothing );
+      const uint32_t skip = _options.skip_signatures ? uint32_t( database::skip_transaction_signatures )
+                                                     : uint32_t( database::skip_nothing );
+      const fc::time_point start = fc::time_point::now();
+      _validator.push_block( block, skip );
+      block_us.push_back( ( fc::time_point::now() - start ).count() );
+      FC_ASSERT( _validator.head_block_id() == _producer.head_block_id() );
+   }
+
+   void chain_benchmark::seed( const std::function<void( database& )>& f )
+   {
+      for( database* db : { &_producer, &_validator } )
+      {
+         db->clear_pending();
+         db->_undo_db.disable();
+         f( *db );
+         db->_undo_db.enable();
+      }
+   }
+
+   step_result chain_benchmark::run_step( const step& s )
+   {
+      step_result result;
+      result.name = s.name;
+      _validator.get_profiler().reset();
+
+      vector<uint64_t> block_us;
+      string op_name;
+      bool exhausted = false;
+      while( !exhausted )
+      {
+         uint32_t in_block = 0;
+         while( in_block < _options.ops_per_block )
+         {
+            optional<operation> op = s.next();
+            if( !op.valid() )
+            {
+               exhausted = true;
+               break;
+            }
+            if( op_name.empty() )
+               op_name = op->visit( operation_name_visitor() );
+            const operation_result op_result = push( *op );
+            if( s.on_result )
+               s.on_result( op_result );
+            ++in_block;
+         }
+         if( in_block == 0 )
+            break;
+         produce_block( block_us );
+         result.ops += in_block;
+      }
+
+      result.blocks = block_us.size();
+      for( uint64_t us : block_us )
+         result.seconds += us / 1000000.0;
+      if( result.seconds > 0 )
+         result.ops_per_second = result.ops / result.seconds;
+      if( !block_us.empty() )
+      {
+         std::sort( block_us.begin(), block_us.end() );
+         result.block_p50_us = block_us[block_us.size() / 2];
+         result.block_max_us = block_us.back();
+      }
+      const string profile_name = op_name + ".total";
+      for( const profile_summary& summary : _validator.get_profiler().get_operation_profile() )
+         if( summary.name == profile_name )
+         {
+            result.op_p50_ns = summary.p50_ns;
+            result.op_p99_ns = summary.p99_ns;
+         }
+      result.rss_kb = resident_set_kb();
+      return result;
+   }
+
+   chain_benchmark::step chain_benchmark::per_index( const string& name, uint32_t count,
+                                                     const std::function<operation( uint32_t )>& make,
+                                                     const std::function<void( uint32_t, const operation_result& )>& on_result )
+   {
+      auto index = std::make_shared<uint32_t>( 0 );
+      step s;
+      s.name = name;
+      s.next = [index, count, make]() -> optional<operation> {
+         if( *index >= count )
+            return optional<operation>();
+         return make( ( *index )++ );
+      };
+      if( on_result )
+         s.on_result = [index, on_result]( const operation_result& r ) { on_result( *index - 1, r ); };
+      return s;
+   }
+
+   void chain_benchmark::add_setup_steps( vector<step>& steps )
+   {
+      steps.push_back( per_index( "claim_genesis_balance", 1, [this]( uint32_t ) {
+         balance_claim_operation op;
+         op.deposit_to_account = _bank;
+         op.balance_to_claim = balance_id_type();
+         op.balance_owner_key = _pub;
+         op.total_claimed = asset( GRAPHENE_MAX_SHARE_SUPPLY / 2 );
+         return operation( op );
+      } ) );
+
+      // account i is referred by account (i-1)/fanout, so the referral tree is log_fanout(accounts) levels deep
+      steps.push_back( per_index( "register_accounts", _options.accounts, [this]( uint32_t i ) {
+         account_create_operation op;
+         op.registrar = _bank;
+         op.referrer = i == 0 ? _bank : _accounts[( i - 1 ) / _options.fanout];
+         op.name = "bench-a" + std::to_string( i );
+         op.owner = authority( 1, _pub, 1 );
+         op.active = authority( 1, _pub, 1 );
+         op.options.memo_key = _pub;
+         return operation( op );
+      }, [this]( uint32_t, const operation_result& r ) {
+         _accounts.push_back( r.get<object_id_type>() );
+      } ) );
+
+      steps.push_back( per_index( "fund_accounts", _options.accounts, [this]( uint32_t i ) {
+         transfer_operation op;
+         op.from = _bank;
+         op.to = _accounts[i];
+         op.amount = asset( 20000 * cwd );
+         return operation( op );
+      } ) );
+   }
+
+   void chain_benchmark::add_scenario_steps( vector<step>& steps )
+   {
+      const uint32_t n = _options.accounts;
+
+      if( wants( "transfer" ) )
+         steps.push_back( per_index( "transfer", n, [this, n]( uint32_t i ) {
+            transfer_operation op;
+            op.from = _accounts[i];
+            op.to = _accounts[( i + 1 ) % n];
+            op.amount = asset( cwd );
+            return operation( op );
+         } ) );
+
+      if( wants( "send_message" ) )
+         steps.push_back( per_index( "send_message", n, [this, n]( uint32_t i ) {
+            send_message_operation op;
+            op.from = _accounts[i];
+            op.to = _accounts[( i + 1 ) % n];
+            op.memo.from = _pub;
+            op.memo.to = _pub;
+            op.memo.set_message( _key, _pub, "benchmark message " + std::to_string( i ), i + 1 );
+            return operation( op );
+         } ) );
+
+      // the upgrade fee is shared out along the whole referral path of the account
+      if( wants( "status_upgrade" ) )
+         steps.push_back( per_index( "account_status_upgrade", n, [this]( uint32_t i ) {
+            account_status_upgrade_operation op;
+            op.account_to_upgrade = _accounts[i];
+            op.referral_status_type = 1;
+            return operation( op );
+         } ) );
+
+      if( wants( "flipcoin" ) )
+      {
+         const share_type bet = _producer.get_global_properties().gamezone_parameters.flipcoin_min_bet_amount;
+         auto flipcoins = std::make_shared<vector<flipcoin_id_type>>();
+         steps.push_back( per_index( "flipcoin_bet", n / 2, [this, bet]( uint32_t i ) {
+            flipcoin_bet_operation op;
+            op.bettor = _accounts[2 * i];
+            op.bet = asset( bet );
+            op.nonce = uint8_t( i );
+            return operation( op );
+         }, [flipcoins]( uint32_t, const operation_result& r ) {
+            flipcoins->push_back( r.get<object_id_type>() );
+         } ) );
+         steps.push_back( per_index( "flipcoin_call", n / 2, [this, bet, flipcoins]( uint32_t i ) {
+            flipcoin_call_operation op;
+            op.flipcoin = ( *flipcoins )[i];
+            op.caller = _accounts[2 * i + 1];
+            op.bet = asset( bet );
+            return operation( op );
+         } ) );
+      }
+
+      if( wants( "credit" ) )
+         steps.push_back( per_index( "credit_offer_create", n, [this]( uint32_t i ) {
+            credit_offer_create_operation op;
+            op.creditor = _accounts[i];
+            op.min_income = 0;
+            op.credit_amount = asset( 100 * cwd );
+            op.repay_amount = asset( 110 * cwd );
+            return operation( op );
+         } ) );
+
+      if( wants( "pledge" ) )
+      {
+         auto offers = std::make_shared<vector<pledge_offer_id_type>>();
+         steps.push_back( per_index( "pledge_offer_give_create", n / 2, [this]( uint32_t i ) {
+            pledge_offer_give_create_operation op;
+            op.creditor = _accounts[2 * i];
+            op.pledge_amount = asset( 200 * cwd );
+            op.credit_amount = asset( 100 * cwd );
+            op.repay_amount = asset( 110 * cwd );
+            op.pledge_days = 30;
+            return operation( op );
+         }, [offers]( uint32_t, const operation_result& r ) {
+            offers->push_back( r.get<object_id_type>() );
+         } ) );
+         steps.push_back( per_index( "pledge_offer_fill", n / 2, [this, offers]( uint32_t i ) {
+            pledge_offer_fill_operation op;
+            op.account = _accounts[2 * i + 1];
+            op.debitor = _accounts[2 * i + 1];
+            op.creditor = _accounts[2 * i];
+            op.pledge_amount = asset( 200 * cwd );
+            op.credit_amount = asset( 100 * cwd );
+            op.repay_amount = asset( 110 * cwd );
+            op.pledge_days = 30;
+            op.pledge_offer = ( *offers )[i];
+            return operation( op );
+         } ) );
+      }
+
+      if( wants( "poc_stak" ) )
+      {
+         const share_type amount = _producer.get_global_properties().staking_parameters.poc3_min_amount;
+         steps.push_back( per_index( "poc_stak", n, [this, amount]( uint32_t i ) {
+            poc_stak_operation op;
+            op.account = _accounts[i];
+            op.stak_amount = asset( amount );
+            op.staking_type = 3;
+            return operation( op );
+         } ) );
+      }
+
+      if( wants( "p2p" ) )
+      {
+         // the first accounts become gateways, every other account opens one order with one of them
+         const uint32_t gateways = std::max<uint32_t>( 1, std::min<uint32_t>( 10, n / 10 ) );
+         const share_type order = 10 * cwd;
+         steps.push_back( per_index( "p2p_gateway_funding", gateways, [this, n, gateways, order]( uint32_t i ) {
+            transfer_operation op;
+            op.from = _bank;
+            op.to = _accounts[i];
+            op.amount = asset( 10000 * cwd + order * ( n / gateways + 1 ) );
+            return operation( op );
+         } ) );
+         steps.push_back( per_index( "p2p_gateway_upgrade", gateways, [this]( uint32_t i ) {
+            account_status_upgrade_operation op;
+            op.account_to_upgrade = _accounts[i];
+            op.referral_status_type = 4;
+            return operation( op );
+         } ) );
+         auto advs = std::make_shared<vector<p2p_adv_id_type>>();
+         steps.push_back( per_index( "create_p2p_adv", gateways, [this]( uint32_t i ) {
+            create_p2p_adv_operation op;
+            op.p2p_gateway = _accounts[i];
+            op.adv_type = true;
+            op.adv_description = "benchmark advertisement";
+            op.min_cwd = cwd;
+            op.max_cwd = 1000000 * cwd;
+            op.price = 100;
+            op.currency = "USD";
+            return operation( op );
+         }, [advs]( uint32_t, const operation_result& r ) {
+            advs->push_back( r.get<object_id_type>() );
+         } ) );
+         steps.push_back( per_index( "create_p2p_order", n - gateways, [this, gateways, order, advs]( uint32_t i ) {
+            create_p2p_order_operation op;
+            op.p2p_adv = ( *advs )[i % gateways];
+            op.p2p_gateway = _accounts[i % gateways];
+            op.p2p_client = _accounts[gateways + i];
+            op.amount = asset( order );
+            op.price = 100;
+            return operation( op );
+         } ) );
+      }
+
+      if( wants( "matrix" ) )
+      {
+         // matrices are only started by the chain itself at a fixed block height, far beyond this chain
+         auto matrix = std::make_shared<matrix_id_type>();
+         steps.push_back( { "seed_matrix", [this, matrix]() -> optional<operation> {
+            seed( [matrix]( database& db ) {
+               *matrix = db.create<matrix_object>( [&db]( matrix_object& m ) {
+                  m.start_block_number = db.head_block_num();
+                  m.finish_block_number = db.head_block_num() + 1000000;
+                  m.status = 0;
+                  m.amount = 0;
+                  m.total_amount = 0;
+                  m.last_120k_amount = 0;
+                  m.matrix_level_1_price = 45 * cwd;
+                  m.matrix_level_2_price = 80 * cwd;
+                  m.matrix_level_3_price = 218 * cwd;
+                  m.matrix_level_4_price = 790 * cwd;
+                  m.matrix_level_5_price = 2870 * cwd;
+                  m.matrix_level_6_price = 7820 * cwd;
+                  m.matrix_level_7_price = 14200 * cwd;
+                  m.matrix_level_8_price = 25800 * cwd;
+                  m.matrix_level_1_prize = 90 * cwd;
+                  m.matrix_level_2_prize = 240 * cwd;
+                  m.matrix_level_3_prize = 872 * cwd;
+                  m.matrix_level_4_prize = 3160 * cwd;
+                  m.matrix_level_5_prize = 8610 * cwd;
+                  m.matrix_level_6_prize = 15640 * cwd;
+                  m.matrix_level_7_prize = 28400 * cwd;
+                  m.matrix_level_8_prize = 51600 * cwd;
+                  m.matrix_level_1_cells = 2;
+                  m.matrix_level_2_cells = 3;
+                  m.matrix_level_3_cells = 4;
+                  m.matrix_level_4_cells = 4;
+                  m.matrix_level_5_cells = 3;
+                  m.matrix_level_6_cells = 2;
+                  m.matrix_level_7_cells = 2;
+                  m.matrix_level_8_cells = 2;
+               } ).id;
+            } );
+            return optional<operation>();
+         }, {} } );
+         steps.push_back( per_index( "matrix_open_room", n, [this, matrix]( uint32_t i ) {
+            matrix_open_room_operation op;
+            op.matrix_id = *matrix;
+            op.player = _accounts[i];
+            op.matrix_level = 1;
+            op.level_price = asset( 45 * cwd );
+            return operation( op );
+         } ) );
+      }
+
+      if( wants( "great_race" ) )
+      {
+         // teams are normally registered by captains during the registration interval of a race
+         const uint32_t teams = std::max<uint32_t>( 1, std::min<uint32_t>( 10, n ) );
+         auto team_ids = std::make_shared<vector<gr_team_id_type>>();
+         steps.push_back( { "seed_great_race", [this, teams, team_ids]() -> optional<operation> {
+            seed( [this, teams, team_ids]( database& db ) {
+               for( uint32_t t = 0; t < teams; ++t )
+               {
+                  const gr_team_id_type id = db.create<gr_team_object>( [this, t]( gr_team_object& team ) {
+                     team.name = "team" + std::to_string( t );
+                     team.captain = _accounts[t];
+                  } ).id;
+                  if( &db == &_producer )
+                     team_ids->push_back( id );
+               }
+               db.modify( db.get_dynamic_global_properties(), []( dynamic_global_property_object& dgpo ) {
+                  dgpo.gr_bet_interval_time = fc::time_point_sec::maximum();
+               } );
+            } );
+            return optional<operation>();
+         }, {} } );
+         steps.push_back( per_index( "gr_range_bet", n, [this, teams, team_ids]( uint32_t i ) {
+            gr_range_bet_operation op;
+            op.team = ( *team_ids )[i % teams];
+            op.lower_rank = 1;
+            op.upper_rank = std::min<uint32_t>( 3, teams );
+            op.result = true;
+            op.bettor = _accounts[i];
+            op.bet = asset( 5 * cwd );
+            return operation( op );
+         } ) );
+      }
+   }
+
+   vector<step_result> chain_benchmark::run()
+   {
+      vector<step> steps;
+      add_setup_steps( steps );
+      add_scenario_steps( steps );
+
+      vector<step_result> results;
+      for( const step& s : steps )
+      {
+         results.push_back( run_step( s ) );
+         if( results.back().ops == 0 )
+            results.pop_back();
+      }
+      if( wants( "modify" ) )
+      {
+         const vector<step_result> mutations = run_mutation_benchmark();
+         results.insert( results.end(), mutations.begin(), mutations.end() );
+      }
+      return results;
+   }
+
+   vector<step_result> chain_benchmark::run_mutation_benchmark()
+   {
+      const uint32_t rounds = 20;
+      vector<const account_statistics_object*> stats;
+      for( const account_statistics_object& s : _validator.get_index_type<account_stats_index>().indices() )
+         stats.push_back( &s );
+      const auto& matrices = _validator.get_index_type<matrix_index>().indices();
+      const matrix_id_type matrix = matrices.empty() ? matrix_id_type() : matrix_id_type( matrices.begin()->id );
+      graphene::db::index& stats_index =
+         const_cast<graphene::db::index&>( _validator.get_index<account_statistics_object>() );
+      graphene::db::index& rooms_index =
+         const_cast<graphene::db::index&>( _validator.get_index<matrix_rooms_object>() );
+
+      // every change is recorded for undo like in a block, and the session is undone after each measurement
+      _validator.clear_pending();
+      auto measure = [this]( const string& name, uint64_t ops, const std::function<void()>& f ) {
+         step_result result;
+         result.name = name;
+         result.ops = ops;
+         {
+            auto session = _validator._undo_db.start_undo_session();
+            const fc::time_point start = fc::time_point::now();
+            f();
+            result.seconds = ( fc::time_point::now() - start ).count() / 1000000.0;
+         }
+         if( result.seconds > 0 )
+            result.ops_per_second = ops / result.seconds;
+         result.op_p50_ns = ops > 0 ? uint64_t( result.seconds * 1e9 / ops ) : 0;
+         result.rss_kb = resident_set_kb();
+         return result;
+      };
+
+      vector<step_result> results;
+      results.push_back( measure( "modify_stats", rounds * stats.size(), [&]() {
+         for( uint32_t r = 0; r < rounds; ++r )
+            for( const account_statistics_object* s : stats )
+               _validator.modify( *s, []( account_statistics_object& o ) { o.pending_fees += 1; } );
+      } ) );
+      results.push_back( measure( "modify_stats_erased", rounds * stats.size(), [&]() {
+         for( uint32_t r = 0; r < rounds; ++r )
+            for( const account_statistics_object* s : stats )
+               stats_index.modify( *s, std::function<void( object& )>( []( object& o ) {
+                  static_cast<account_statistics_object&>( o ).pending_fees += 1;
+               } ) );
+      } ) );
+      results.push_back( measure( "create_rooms", rounds * _accounts.size(), [&]() {
+         for( uint32_t r = 0; r < rounds; ++r )
+            for( const account_id_type& a : _accounts )
+               _validator.create<matrix_rooms_object>( [&]( matrix_rooms_object& room ) {
+                  room.matrix = matrix;
+                  room.matrix_player = a;
+                  room.matrix_level = 1;
+                  room.total_cells = 3;
+               } );
+      } ) );
+      results.push_back( measure( "create_rooms_erased", rounds * _accounts.size(), [&]() {
+         for( uint32_t r = 0; r < rounds; ++r )
+            for( const account_id_type& a : _accounts )
+               rooms_index.create( [&]( object& o ) {
+                  matrix_rooms_object& room = static_cast<matrix_rooms_object&>( o );
+                  room.matrix = matrix;
+                  room.matrix_player = a;
+                  room.matrix_level = 1;
+                  room.total_cells = 3;
+               } );
+      } ) );
+      return results;
+   }
+
+} // anonymous namespace
+
+FC_REFLECT( step_result, (name)(ops)(blocks)(seconds)(ops_per_second)(block_p50_us)(block_max_us)
+                         (op_p50_ns)(op_p99_ns)(rss_kb) )
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      bpo::options_description cli_options( "CrowdWiz block apply benchmark" );
+      cli_options.add_options()
+         ( "help,h", "Print this help message and exit" )
+         ( "accounts", bpo::value<uint32_t>()->default_value( 2000 ), "Number of accounts in the referral tree" )
+         ( "fanout", bpo::value<uint32_t>()->default_value( 3 ), "Number of accounts referred by every account" )
+         ( "ops-per-block", bpo::value<uint32_t>()->default_value( 200 ), "Operations in every benchmark block" )
+         ( "scenarios", bpo::value<string>()->default_value( "all" ),
+           "Comma separated scenarios: transfer, send_message, status_upgrade, flipcoin, credit, pledge, poc_stak, "
+           "p2p, matrix, great_race, modify" )
+         ( "skip-signatures", bpo::bool_switch()->default_value( false ),
+           "Do not verify transaction signatures when applying blocks" )
+         ( "data-dir", bpo::value<boost::filesystem::path>(),
+           "Directory for the chain databases, a temporary directory is used when not given" )
+         ( "json", bpo::bool_switch()->default_value( false ), "Print results as JSON" );
+
+      bpo::variables_map options;
+      bpo::store( bpo::parse_command_line( argc, argv, cli_options ), options );
+      bpo::notify( options );
+      if( options.count( "help" ) )
+      {
+         std::cout << cli_options << "\n";
+         return 0;
+      }
+
+      chain_benchmark::options o;
+      o.accounts = options["accounts"].as<uint32_t>();
+      o.fanout = options["fanout"].as<uint32_t>();
+      o.ops_per_block = options["ops-per-block"].as<uint32_t>();
+      o.skip_signatures = options["skip-signatures"].as<bool>();
+      FC_ASSERT( o.accounts >= 2, "At least two accounts are needed" );
+      FC_ASSERT( o.fanout > 0 && o.ops_per_block > 0 );
+      const string scenarios = options["scenarios"].as<string>();
+      if( scenarios != "all" )
+         boost::split( o.scenarios, scenarios, boost::is_any_of( "," ) );
+      if( options.count( "data-dir" ) )
+         o.data_dir = options["data-dir"].as<boost::filesystem::path>();
+
+      vector<step_result> results;
+      {
+         chain_benchmark benchmark( o );
+         results = benchmark.run();
+      }
+
+      if( options["json"].as<bool>() )
+      {
+         std::cout << fc::json::to_pretty_string( results ) << "\n";
+         return 0;
+      }
+      std::cout << std::left << std::setw( 26 ) << "step" << std::right
+                << std::setw( 8 ) << "ops" << std::setw( 8 ) << "blocks" << std::setw( 12 ) << "ops/s"
+                << std::setw( 12 ) << "blk p50 us" << std::setw( 12 ) << "blk max us"
+                << std::setw( 12 ) << "op p50 ns" << std::setw( 12 ) << "op p99 ns" << std::setw( 12 ) << "rss KiB"
+                << "\n";
+      for( const step_result& r : results )
+         std::cout << std::left << std::setw( 26 ) << r.name << std::right
+                   << std::setw( 8 ) << r.ops << std::setw( 8 ) << r.blocks
+                   << std::setw( 12 ) << uint64_t( r.ops_per_second )
+                   << std::setw( 12 ) << r.block_p50_us << std::setw( 12 ) << r.block_max_us
+                   << std::setw( 12 ) << r.op_p50_ns << std::setw( 12 ) << r.op_p99_ns << std::setw( 12 ) << r.rss_kb
+                   << "\n";
+      return 0;
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+   }
+   return 1;
+}